@@ -39,6 +39,12 @@
 Max7219::Max7219(SPI *spi_bus, PinName cs): _p_spi(spi_bus)
 {
     _num_devices = 1;
+    _busy = false;
+    _pending = 0;
+    _frame_count = 0;
+    _p_shadow = new uint8_t[16];
+    _p_known = new uint16_t[1];
+    _p_known[0] = 0;
     
     _p_cs = new DigitalOut(cs, 1);
     _spi_owner = false;
@@ -49,6 +55,12 @@ Max7219::Max7219(SPI *spi_bus, PinName cs): _p_spi(spi_bus)
 Max7219::Max7219(PinName mosi, PinName miso, PinName sclk, PinName cs)
 {
     _num_devices = 1;
+    _busy = false;
+    _pending = 0;
+    _frame_count = 0;
+    _p_shadow = new uint8_t[16];
+    _p_known = new uint16_t[1];
+    _p_known[0] = 0;
     
     _p_spi = new SPI(mosi, miso, sclk);
     _p_cs = new DigitalOut(cs, 1);
@@ -61,6 +73,8 @@ Max7219::Max7219(PinName mosi, PinName miso, PinName sclk, PinName cs)
 Max7219::~Max7219()
 {
     delete _p_cs;
+    delete [] _p_shadow;
+    delete [] _p_known;
     
     if(_spi_owner) 
     {
@@ -70,47 +84,226 @@ Max7219::~Max7219()
 
 
 //*********************************************************************
-int32_t Max7219::set_num_devices(uint8_t num_devices)
+void Max7219::wait_idle(void)
 {
-    int32_t rtn_val = -1;
+#if DEVICE_SPI_ASYNCH
+    uint32_t start = us_ticker_read();
     
-    if(num_devices > 0)
+    //the completion interrupt wakes the core; an ISR cannot be
+    //preempted by it, so there the wait only polls until the timeout
+    while(_busy && ((us_ticker_read() - start) < MAX7219_BUSY_TIMEOUT_US))
     {
-        _num_devices = num_devices;
-        rtn_val = _num_devices;
+        if(!core_util_is_isr_active())
+        {
+            sleep();
+        }
     }
     
-    return(rtn_val);
+    //the transfer is lost, so what the devices hold is unknown
+    if(_busy)
+    {
+        _p_spi->abort_transfer();
+        _p_cs->write(1); 
+        _busy = false;
+        invalidate_cache();
+    }
+#endif
 }
 
 
 //*********************************************************************
-void Max7219::set_display_test(void)
+void Max7219::fill_frame(uint8_t reg, uint8_t data)
 {
-    uint8_t idx = 0;
+    uint16_t idx = 0;
+    
+    //the frame may still be going out asynchronously
+    wait_idle();
+    
+    for(idx = 0; idx < 2 * _num_devices; idx += 2)
+    {
+        _frame[idx] = MAX7219_NO_OP;
+        _frame[idx + 1] = 0;
+    }
+    _pending = 0;
+    
+    if(reg != MAX7219_NO_OP)
+    {
+        for(idx = 1; idx <= _num_devices; idx++)
+        {
+            set_frame(idx, reg, data);
+        }
+    }
+}
+
+
+//*********************************************************************
+void Max7219::set_frame(uint8_t device_number, uint8_t reg, uint8_t data)
+{
+    //last device in the chain is shifted out first
+    uint16_t pos = 2 * (_num_devices - device_number);
+    uint16_t shadow = 16 * (device_number - 1) + reg;
+    uint16_t bit = 1 << reg;
+    
+    //skip registers already known to hold the value
+    if((_p_known[device_number - 1] & bit) && (_p_shadow[shadow] == data))
+    {
+        return;
+    }
+    
+    _frame[pos] = reg;
+    _frame[pos + 1] = data;
+    _p_shadow[shadow] = data;
+    _p_known[device_number - 1] |= bit;
+    _pending++;
+}
+
+
+//*********************************************************************
+void Max7219::send_frame(void)
+{
+    //nothing would change
+    if(_pending == 0)
+    {
+        return;
+    }
     
     _p_cs->write(0); 
+    _p_spi->write((const char *) _frame, 2 * _num_devices, NULL, 0);
+    _p_cs->write(1); 
+    
+    _pending = 0;
+    _frame_count++;
+}
+
+
+//*********************************************************************
+bool Max7219::busy(void)
+{
+    return(_busy);
+}
+
+
+//*********************************************************************
+void Max7219::invalidate_cache(void)
+{
+    uint16_t idx = 0;
+    
     for(idx = 0; idx < _num_devices; idx++)
     {
-        _p_spi->write(MAX7219_DISPLAY_TEST);
-        _p_spi->write(1);
+        _p_known[idx] = 0;
     }
+}
+
+
+//*********************************************************************
+uint32_t Max7219::get_frame_count(void)
+{
+    return(_frame_count);
+}
+
+
+#if DEVICE_SPI_ASYNCH
+//*********************************************************************
+void Max7219::on_transfer(int event)
+{
     _p_cs->write(1); 
+    _busy = false;
 }
 
 
 //*********************************************************************
-void Max7219::clear_display_test(void)
+int32_t Max7219::write_digit_all_async(uint8_t digit, const uint8_t *data, uint8_t num_data)
 {
+    int32_t rtn_val = -1;
     uint8_t idx = 0;
     
-    _p_cs->write(0); 
-    for(idx = 0; idx < _num_devices; idx++)
+    if(digit > MAX7219_DIGIT_7)
     {
-        _p_spi->write(MAX7219_DISPLAY_TEST);
-        _p_spi->write(0);
+        rtn_val = -3;
     }
-    _p_cs->write(1); 
+    else if(digit < MAX7219_DIGIT_0)
+    {
+        rtn_val = -4;
+    }
+    else if(num_data > _num_devices)
+    {
+        rtn_val = -1;
+    }
+    else
+    {
+        fill_frame(MAX7219_NO_OP, 0);
+        for(idx = 1; idx <= num_data; idx++)
+        {
+            set_frame(idx, digit, data[idx - 1]);
+        }
+        
+        //nothing would change
+        if(_pending == 0)
+        {
+            return(0);
+        }
+        
+        //cs is raised again by on_transfer
+        _pending = 0;
+        _frame_count++;
+        _busy = true;
+        _p_cs->write(0); 
+        if(_p_spi->transfer(_frame, 2 * _num_devices, (uint8_t *) NULL, 0,
+            event_callback_t(this, &Max7219::on_transfer), SPI_EVENT_COMPLETE) != 0)
+        {
+            _p_cs->write(1); 
+            _busy = false;
+            invalidate_cache();
+            rtn_val = -5;
+        }
+        else
+        {
+            rtn_val = 0;
+        }
+    }
+    
+    return(rtn_val);
+}
+#endif
+
+
+//*********************************************************************
+int32_t Max7219::set_num_devices(uint8_t num_devices)
+{
+    int32_t rtn_val = -1;
+    
+    if(num_devices > 0)
+    {
+        //the frame may still be going out asynchronously
+        wait_idle();
+        
+        delete [] _p_shadow;
+        delete [] _p_known;
+        _p_shadow = new uint8_t[16 * num_devices];
+        _p_known = new uint16_t[num_devices];
+        
+        _num_devices = num_devices;
+        invalidate_cache();
+        rtn_val = _num_devices;
+    }
+    
+    return(rtn_val);
+}
+
+
+//*********************************************************************
+void Max7219::set_display_test(void)
+{
+    fill_frame(MAX7219_DISPLAY_TEST, 1);
+    send_frame();
+}
+
+
+//*********************************************************************
+void Max7219::clear_display_test(void)
+{
+    fill_frame(MAX7219_DISPLAY_TEST, 0);
+    send_frame();
 }
 
 
@@ -118,7 +311,6 @@ void Max7219::clear_display_test(void)
 int32_t Max7219::init_device(max7219_configuration_t config)
 {
     int32_t rtn_val = -1;
-    uint8_t idx = 0;
     
     if(config.device_number > _num_devices)
     {
@@ -132,61 +324,19 @@ int32_t Max7219::init_device(max7219_configuration_t config)
     else
     {
         //write DECODE_MODE register of device
-        _p_cs->write(0); 
-        for(idx = _num_devices; idx > 0; idx--)
-        {
-            if(config.device_number == idx)
-            {
-                _p_spi->write(MAX7219_DECODE_MODE);
-                _p_spi->write(config.decode_mode);
-            }
-            else
-            {
-                _p_spi->write(MAX7219_NO_OP);
-                _p_spi->write(0);
-            }
-        }
-        _p_cs->write(1); 
-        
-        wait_us(1);
+        fill_frame(MAX7219_NO_OP, 0);
+        set_frame(config.device_number, MAX7219_DECODE_MODE, config.decode_mode);
+        send_frame();
         
         //write INTENSITY register of device
-        _p_cs->write(0); 
-        for(idx = _num_devices; idx > 0; idx--)
-        {
-            if(config.device_number == idx)
-            {
-                _p_spi->write(MAX7219_INTENSITY);
-                _p_spi->write(config.intensity);
-            }
-            else
-            {
-                _p_spi->write(MAX7219_NO_OP);
-                _p_spi->write(0);
-            }
-        }
-        _p_cs->write(1); 
-        
-        wait_us(1);
+        fill_frame(MAX7219_NO_OP, 0);
+        set_frame(config.device_number, MAX7219_INTENSITY, config.intensity);
+        send_frame();
         
         //write SCAN_LIMT register of device
-        _p_cs->write(0); 
-        for(idx = _num_devices; idx > 0; idx--)
-        {
-            if(config.device_number == idx)
-            {
-                _p_spi->write(MAX7219_SCAN_LIMIT);
-                _p_spi->write(config.scan_limit);
-            }
-            else
-            {
-                _p_spi->write(MAX7219_NO_OP);
-                _p_spi->write(0);
-            }
-        }
-        _p_cs->write(1); 
-        
-        wait_us(1);
+        fill_frame(MAX7219_NO_OP, 0);
+        set_frame(config.device_number, MAX7219_SCAN_LIMIT, config.scan_limit);
+        send_frame();
         
         rtn_val = 0;
     }
@@ -198,40 +348,18 @@ int32_t Max7219::init_device(max7219_configuration_t config)
 //*********************************************************************
 void Max7219::init_display(max7219_configuration_t config)
 {
-    uint8_t idx = 0;
     
     //write DECODE_MODE register of all devices
-    _p_cs->write(0); 
-    for(idx = 0; idx < _num_devices; idx++)
-    {
-        _p_spi->write(MAX7219_DECODE_MODE);
-        _p_spi->write(config.decode_mode);
-    }
-    _p_cs->write(1); 
-    
-    wait_us(1);
+    fill_frame(MAX7219_DECODE_MODE, config.decode_mode);
+    send_frame();
     
     //write INTENSITY register of all devices
-    _p_cs->write(0); 
-    for(idx = 0; idx < _num_devices; idx++)
-    {
-        _p_spi->write(MAX7219_INTENSITY);
-        _p_spi->write(config.intensity);
-    }
-    _p_cs->write(1); 
-    
-    wait_us(1);
+    fill_frame(MAX7219_INTENSITY, config.intensity);
+    send_frame();
     
     //write SCAN_LIMT register of all devices
-    _p_cs->write(0); 
-    for(idx = 0; idx < _num_devices; idx++)
-    {
-        _p_spi->write(MAX7219_SCAN_LIMIT);
-        _p_spi->write(config.scan_limit);
-    }
-    _p_cs->write(1); 
-    
-    wait_us(1);
+    fill_frame(MAX7219_SCAN_LIMIT, config.scan_limit);
+    send_frame();
 }
 
 
@@ -239,7 +367,6 @@ void Max7219::init_display(max7219_configuration_t config)
 int32_t Max7219::enable_device(uint8_t device_number)
 {
     int32_t rtn_val = -1;
-    uint8_t idx = 0;
     
     if(device_number > _num_devices)
     {
@@ -252,21 +379,9 @@ int32_t Max7219::enable_device(uint8_t device_number)
     }
     else
     {
-        _p_cs->write(0); 
-        for(idx = _num_devices; idx > 0; idx--)
-        {
-            if(device_number == idx)
-            {
-                _p_spi->write(MAX7219_SHUTDOWN);
-                _p_spi->write(1);
-            }
-            else
-            {
-                _p_spi->write(MAX7219_NO_OP);
-                _p_spi->write(0);
-            }
-        }
-        _p_cs->write(1); 
+        fill_frame(MAX7219_NO_OP, 0);
+        set_frame(device_number, MAX7219_SHUTDOWN, 1);
+        send_frame();
         
         rtn_val = 0;
     }
@@ -278,15 +393,8 @@ int32_t Max7219::enable_device(uint8_t device_number)
 //*********************************************************************
 void Max7219::enable_display(void)
 {
-    uint8_t idx = 0;
-    
-    _p_cs->write(0); 
-    for(idx = 0; idx < _num_devices; idx++)
-    {
-        _p_spi->write(MAX7219_SHUTDOWN);
-        _p_spi->write(1);
-    }
-    _p_cs->write(1); 
+    fill_frame(MAX7219_SHUTDOWN, 1);
+    send_frame();
 }
     
 
@@ -294,7 +402,6 @@ void Max7219::enable_display(void)
 int32_t Max7219::disable_device(uint8_t device_number)
 {
     int32_t rtn_val = -1;
-    uint8_t idx = 0;
     
     if(device_number > _num_devices)
     {
@@ -307,21 +414,9 @@ int32_t Max7219::disable_device(uint8_t device_number)
     }
     else
     {
-        _p_cs->write(0); 
-        for(idx = _num_devices; idx > 0; idx--)
-        {
-            if(device_number == idx)
-            {
-                _p_spi->write(MAX7219_SHUTDOWN);
-                _p_spi->write(0);
-            }
-            else
-            {
-                _p_spi->write(MAX7219_NO_OP);
-                _p_spi->write(0);
-            }
-        }
-        _p_cs->write(1); 
+        fill_frame(MAX7219_NO_OP, 0);
+        set_frame(device_number, MAX7219_SHUTDOWN, 0);
+        send_frame();
         
         rtn_val = 0;
     }
@@ -333,15 +428,8 @@ int32_t Max7219::disable_device(uint8_t device_number)
 //*********************************************************************    
 void Max7219::disable_display(void)
 {
-    uint8_t idx = 0;
-    
-    _p_cs->write(0); 
-    for(idx = 0; idx < _num_devices; idx++)
-    {
-        _p_spi->write(MAX7219_SHUTDOWN);
-        _p_spi->write(0);
-    }
-    _p_cs->write(1); 
+    fill_frame(MAX7219_SHUTDOWN, 0);
+    send_frame();
 }
 
 
@@ -350,7 +438,6 @@ void Max7219::disable_display(void)
 int32_t Max7219::write_digit(uint8_t device_number, uint8_t digit, uint8_t data)
 {
     int32_t rtn_val = -1;
-    uint8_t idx = 0;
     
     if(digit > MAX7219_DIGIT_7)
     {
@@ -372,21 +459,9 @@ int32_t Max7219::write_digit(uint8_t device_number, uint8_t digit, uint8_t data)
         }
         else
         {
-            _p_cs->write(0); 
-            for(idx = _num_devices; idx > 0; idx--)
-            {
-                if(idx == device_number)
-                {
-                    _p_spi->write(digit);
-                    _p_spi->write(data);
-                }
-                else
-                {
-                    _p_spi->write(MAX7219_NO_OP);
-                    _p_spi->write(0);
-                }
-            }
-            _p_cs->write(1); 
+            fill_frame(MAX7219_NO_OP, 0);
+            set_frame(device_number, digit, data);
+            send_frame();
             
             rtn_val = 0;
         }
@@ -396,11 +471,44 @@ int32_t Max7219::write_digit(uint8_t device_number, uint8_t digit, uint8_t data)
 }
     
 
+//********************************************************************* 
+int32_t Max7219::write_digit_all(uint8_t digit, const uint8_t *data, uint8_t num_data)
+{
+    int32_t rtn_val = -1;
+    uint8_t idx = 0;
+    
+    if(digit > MAX7219_DIGIT_7)
+    {
+        rtn_val = -3;
+    }
+    else if(digit < MAX7219_DIGIT_0)
+    {
+        rtn_val = -4;
+    }
+    else if(num_data > _num_devices)
+    {
+        rtn_val = -1;
+    }
+    else
+    {
+        fill_frame(MAX7219_NO_OP, 0);
+        for(idx = 1; idx <= num_data; idx++)
+        {
+            set_frame(idx, digit, data[idx - 1]);
+        }
+        send_frame();
+        
+        rtn_val = 0;
+    }
+    
+    return(rtn_val);
+}
+    
+
 //*********************************************************************     
 int32_t Max7219::clear_digit(uint8_t device_number, uint8_t digit)
 {
     int32_t rtn_val = -1;
-    uint8_t idx = 0;
     
     if(digit > MAX7219_DIGIT_7)
     {
@@ -422,21 +530,9 @@ int32_t Max7219::clear_digit(uint8_t device_number, uint8_t digit)
         }
         else
         {
-            _p_cs->write(0); 
-            for(idx = _num_devices; idx > 0; idx--)
-            {
-                if(idx == device_number)
-                {
-                    _p_spi->write(digit);
-                    _p_spi->write(0);
-                }
-                else
-                {
-                    _p_spi->write(MAX7219_NO_OP);
-                    _p_spi->write(0);
-                }
-            }
-            _p_cs->write(1); 
+            fill_frame(MAX7219_NO_OP, 0);
+            set_frame(device_number, digit, 0);
+            send_frame();
             
             rtn_val = 0;
         }
@@ -512,30 +608,28 @@ int32_t Max7219::device_all_off(uint8_t device_number)
 
 void Max7219::display_all_on(void)
 {
-    uint8_t idx, idy;
+    uint8_t data[255];
+    uint8_t idy;
     
-    //writes every digit of every device to 0xFF
-    for(idx = 0; idx < _num_devices; idx++)
+    //writes every digit of every device to 0xFF, one frame per digit
+    memset(data, 0xFF, _num_devices);
+    for(idy = MAX7219_DIGIT_0; idy <= MAX7219_DIGIT_7; idy++)
     {
-        for(idy = 0; idy < MAX7219_DIGIT_7; idy++)
-        {
-            write_digit((idx + 1), (idy + 1), 0xFF);
-        }
+        write_digit_all(idy, data, _num_devices);
     }
 }
     
     
 void Max7219::display_all_off(void)
 {
-    uint8_t idx, idy;
+    uint8_t data[255];
+    uint8_t idy;
     
-    //writes every digit of every device to 0
-    for(idx = 0; idx < _num_devices; idx++)
+    //writes every digit of every device to 0, one frame per digit
+    memset(data, 0, _num_devices);
+    for(idy = MAX7219_DIGIT_0; idy <= MAX7219_DIGIT_7; idy++)
     {
-        for(idy = 0; idy < MAX7219_DIGIT_7; idy++)
-        {
-            write_digit((idx + 1), (idy + 1), 0);
-        }
+        write_digit_all(idy, data, _num_devices);
     }
 }
 
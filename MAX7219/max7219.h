@@ -38,6 +38,11 @@
 #include "mbed.h"
 
 
+//longest wait for an asynchronous frame before it is aborted; a full
+//chain of 255 devices takes about 41ms at 100kHz
+#define MAX7219_BUSY_TIMEOUT_US 50000
+
+
 /**
 * @brief Structure for device configuration
 * @code
@@ -383,6 +388,122 @@ class Max7219
     int32_t write_digit(uint8_t device_number, uint8_t digit, uint8_t data);
     
     
+    /**********************************************************//**
+    * @brief Writes the same digit of several devices, each with
+    *        its own data, in a single frame
+    *
+    * @details Devices past num_data get a NO_OP, so a whole chain
+    *          can be refreshed in 8 frames instead of 8 per device
+    *
+    * On Entry:
+    *     @param[in] digit - digit to write
+    *     @param[in] data - data to write, data[0] for device 1
+    *     @param[in] num_data - number of devices in data
+    *
+    * On Exit:
+    *
+    * @return Returns  0 on success\n 
+    *         Returns -1 if num_data is > _num_devices\n
+    *         Returns -3 if digit > 8\n
+    *         Returns -4 if digit < 1\n
+    **************************************************************/
+    int32_t write_digit_all(uint8_t digit, const uint8_t *data, uint8_t num_data);
+    
+    
+#if DEVICE_SPI_ASYNCH
+    /**********************************************************//**
+    * @brief Starts writing the same digit of several devices in
+    *        the background
+    *
+    * @details Same as write_digit_all, but returns as soon as the
+    *          transfer has started. Any later call waits for it to
+    *          finish first, sleeping until its completion interrupt;
+    *          use busy() to poll. A frame still going out after
+    *          MAX7219_BUSY_TIMEOUT_US is aborted and the register
+    *          cache forgotten.
+    *
+    * On Entry:
+    *     @param[in] digit - digit to write
+    *     @param[in] data - data to write, data[0] for device 1
+    *     @param[in] num_data - number of devices in data
+    *
+    * On Exit:
+    *
+    * @return Returns  0 on success\n 
+    *         Returns -1 if num_data is > _num_devices\n
+    *         Returns -3 if digit > 8\n
+    *         Returns -4 if digit < 1\n
+    *         Returns -5 if the SPI peripheral is busy\n
+    **************************************************************/
+    int32_t write_digit_all_async(uint8_t digit, const uint8_t *data, uint8_t num_data);
+#endif
+    
+    
+    /**********************************************************//**
+    * @brief Tells whether a background write is in progress
+    *
+    * @details 
+    *
+    * On Entry:
+    *
+    * On Exit:
+    *
+    * @return Returns true until the last asynchronous frame is out
+    **************************************************************/
+    bool busy(void);
+    
+    
+    /**********************************************************//**
+    * @brief Waits for a background write to finish
+    *
+    * @details Sleeps until the completion interrupt, or polls when
+    *          called from an interrupt. A frame still going out
+    *          after MAX7219_BUSY_TIMEOUT_US is aborted and the
+    *          register cache forgotten. Returns at once if nothing
+    *          is in progress.
+    *
+    * On Entry:
+    *
+    * On Exit:
+    *
+    * @return None
+    **************************************************************/
+    void wait_idle(void);
+    
+    
+    /**********************************************************//**
+    * @brief Forgets the cached register values of all devices
+    *
+    * @details The driver remembers the last value written to every
+    *          register of every device and skips writes that would
+    *          not change it. Call this if the devices may have lost
+    *          their state, e.g. after a power cycle, so the next
+    *          writes go to the wire again.
+    *
+    * On Entry:
+    *
+    * On Exit:
+    *
+    * @return None
+    **************************************************************/
+    void invalidate_cache(void);
+    
+    
+    /**********************************************************//**
+    * @brief Number of frames sent so far
+    *
+    * @details Writes skipped because of the register cache are not
+    *          counted
+    *
+    * On Entry:
+    *
+    * On Exit:
+    *
+    * @return Returns the number of chip-select frames sent
+    **************************************************************/
+    uint32_t get_frame_count(void);
+    
+    
     /**********************************************************//**
     * @brief Clears digit of given device
     *
@@ -467,11 +588,38 @@ class Max7219
       
     private:
     
+    //fills every register/data pair of the frame with the same values
+    void fill_frame(uint8_t reg, uint8_t data);
+    
+    //sets the register/data pair of one device in the frame, unless
+    //the register is known to hold the value already
+    void set_frame(uint8_t device_number, uint8_t reg, uint8_t data);
+    
+    //sends the frame as one block between cs edges, if any pair in
+    //it would change a register
+    void send_frame(void);
+    
+#if DEVICE_SPI_ASYNCH
+    //completion of an asynchronous frame
+    void on_transfer(int event);
+#endif
+    
     SPI *_p_spi;
     DigitalOut *_p_cs;
     bool _spi_owner;
     
     uint8_t _num_devices;
     
+    //one register/data pair per device, last device first
+    uint8_t _frame[2 * 255];
+    uint16_t _pending;
+    volatile bool _busy;
+    uint32_t _frame_count;
+    
+    //last value written to each of the 16 registers of each device,
+    //and a bit per register telling whether that value is known
+    uint8_t *_p_shadow;
+    uint16_t *_p_known;
+    
 };
 #endif /* MAX7219_H*/
\ No newline at end of file
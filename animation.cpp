@@ -0,0 +1,245 @@
+/*
+ * animation.cpp
+ *
+ */
+
+#include "animation.h"
+
+/*---------------------------------------------------------------
+  Font
+ *---------------------------------------------------------------*/
+
+// Columns of 3x5 glyphs, bit 0 at the top, for 0-9 then A-Z
+static const uint8_t font[36][3] = {
+	{0x1F, 0x11, 0x1F},	// 0
+	{0x12, 0x1F, 0x10},	// 1
+	{0x1D, 0x15, 0x17},	// 2
+	{0x11, 0x15, 0x1F},	// 3
+	{0x07, 0x04, 0x1F},	// 4
+	{0x17, 0x15, 0x1D},	// 5
+	{0x1F, 0x15, 0x1D},	// 6
+	{0x01, 0x1D, 0x03},	// 7
+	{0x1F, 0x15, 0x1F},	// 8
+	{0x17, 0x15, 0x1F},	// 9
+	{0x1E, 0x05, 0x1E},	// A
+	{0x1F, 0x15, 0x0A},	// B
+	{0x0E, 0x11, 0x11},	// C
+	{0x1F, 0x11, 0x0E},	// D
+	{0x1F, 0x15, 0x11},	// E
+	{0x1F, 0x05, 0x01},	// F
+	{0x0E, 0x11, 0x1D},	// G
+	{0x1F, 0x04, 0x1F},	// H
+	{0x11, 0x1F, 0x11},	// I
+	{0x08, 0x10, 0x0F},	// J
+	{0x1F, 0x04, 0x1B},	// K
+	{0x1F, 0x10, 0x10},	// L
+	{0x1F, 0x06, 0x1F},	// M
+	{0x1F, 0x01, 0x1E},	// N
+	{0x0E, 0x11, 0x0E},	// O
+	{0x1F, 0x05, 0x02},	// P
+	{0x0E, 0x19, 0x16},	// Q
+	{0x1F, 0x05, 0x1A},	// R
+	{0x12, 0x15, 0x09},	// S
+	{0x01, 0x1F, 0x01},	// T
+	{0x1F, 0x10, 0x1F},	// U
+	{0x0F, 0x10, 0x0F},	// V
+	{0x1F, 0x0C, 0x1F},	// W
+	{0x1B, 0x04, 0x1B},	// X
+	{0x03, 0x1C, 0x03},	// Y
+	{0x19, 0x15, 0x13},	// Z
+};
+
+static const uint8_t bang[3] = {0x00, 0x17, 0x00};
+static const uint8_t blank[3] = {0x00, 0x00, 0x00};
+
+// Columns per character, including the gap after it
+#define GLYPH_WIDTH 4
+
+// Row of the strip the text's top row is drawn on
+#define GLYPH_TOP 1
+
+
+// Glyph for a character, case insensitive
+static const uint8_t* glyph(char c) {
+	if ('a' <= c && c <= 'z') {
+		c = c - 'a' + 'A';
+	}
+	if ('0' <= c && c <= '9') {
+		return font[c - '0'];
+	}
+	if ('A' <= c && c <= 'Z') {
+		return font[c - 'A' + 10];
+	}
+	if (c == '!') {
+		return bang;
+	}
+	return blank;
+}
+
+
+
+/*---------------------------------------------------------------
+  Animation queue
+ *---------------------------------------------------------------*/
+
+enum anim_kind {ANIM_BLINK, ANIM_SWEEP, ANIM_SCROLL};
+
+// A queued animation. Length is its number of frames; phase is the
+// frames per blink phase, or the length of scrolled text.
+typedef struct {
+	anim_kind kind;
+	int length;
+	int phase;
+	const char* text;
+} anim_t;
+
+static framebuffer_t* anim_fb;
+static Ticker ticker;
+static bool ticking = false;
+
+// Frames due, counted by the ticker and taken by anim_poll
+static volatile uint due = 0;
+
+// Ring of animations, the first one playing from frame
+static anim_t queue[ANIM_QUEUE];
+static int first = 0;
+static int count = 0;
+static int frame = -1;
+
+
+// Ticker interrupt: only count
+static void on_tick() {
+	due = due + 1;
+}
+
+
+// Adds an animation and starts the ticker if it was idle
+static bool push(anim_kind kind, int length, int phase, const char* text) {
+	if (count == ANIM_QUEUE) {
+		return false;
+	}
+
+	anim_t* a = &queue[(first + count) % ANIM_QUEUE];
+	a->kind = kind;
+	a->length = length;
+	a->phase = phase;
+	a->text = text;
+	count++;
+
+	if (!ticking) {
+		due = 0;
+		frame = -1;
+		ticking = true;
+		ticker.attach_us(&on_tick, 1000000 / ANIM_FPS);
+	}
+	return true;
+}
+
+
+// Width of the strip in columns
+static int strip_width() {
+	return anim_fb->devices * 8;
+}
+
+
+// Draws one frame of an animation into the framebuffer
+static void draw(const anim_t* a, int f) {
+	switch (a->kind) {
+	case ANIM_BLINK:
+		fb_fill(anim_fb, (f / a->phase) % 2 == 0 ? 0xFF : 0x00);
+		break;
+
+	case ANIM_SWEEP:
+		fb_clear(anim_fb);
+		fb_set(anim_fb, 1 + f / 64, (f / 8) % 8, f % 8, true);
+		break;
+
+	case ANIM_SCROLL:
+		// Text column t is shown at strip column t + width - f
+		fb_clear(anim_fb);
+		for (int x = 0; x < strip_width(); x++) {
+			int t = x + f - strip_width();
+			if (t < 0 || t >= a->phase * GLYPH_WIDTH || t % GLYPH_WIDTH == GLYPH_WIDTH - 1) {
+				continue;
+			}
+			const uint8_t* g = glyph(a->text[t / GLYPH_WIDTH]);
+			fb_row(anim_fb, 1 + x / 8, x % 8, g[t % GLYPH_WIDTH] << GLYPH_TOP);
+		}
+		break;
+	}
+}
+
+
+
+/*---------------------------------------------------------------
+  Animation functions
+ *---------------------------------------------------------------*/
+
+// Remembers the framebuffer
+void init_anim(framebuffer_t* fb) {
+	anim_fb = fb;
+}
+
+
+// On and off phases
+bool anim_blink(int times, int frames) {
+	return push(ANIM_BLINK, times * frames * 2, frames, NULL);
+}
+
+
+// One frame per LED of every device
+bool anim_sweep() {
+	return push(ANIM_SWEEP, anim_fb->devices * 64, 0, NULL);
+}
+
+
+// Until the last column has left the strip
+bool anim_scroll(const char* text) {
+	int len = strlen(text);
+	return push(ANIM_SCROLL, strip_width() + len * GLYPH_WIDTH, len, text);
+}
+
+
+// Catches up with the ticker, skipping frames if it fell behind
+bool anim_poll() {
+	if (count == 0 || due == 0) {
+		return false;
+	}
+
+	core_util_critical_section_enter();
+	uint steps = due;
+	due = 0;
+	core_util_critical_section_exit();
+
+	frame += steps;
+	while (count > 0 && frame >= queue[first].length) {
+		frame -= queue[first].length;
+		first = (first + 1) % ANIM_QUEUE;
+		count--;
+	}
+
+	if (count == 0) {
+		anim_stop();
+	} else {
+		draw(&queue[first], frame);
+		fb_flush(anim_fb);
+	}
+	return true;
+}
+
+
+// Anything left to play
+bool anim_busy() {
+	return count > 0;
+}
+
+
+// Stops the ticker and blanks the display
+void anim_stop() {
+	ticker.detach();
+	ticking = false;
+	count = 0;
+	frame = -1;
+	fb_clear(anim_fb);
+	fb_flush(anim_fb);
+}
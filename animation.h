@@ -0,0 +1,75 @@
+/*
+ * animation.h
+ *
+ * LED animations played at a fixed frame rate. A Ticker only counts
+ * frames that are due; drawing and SPI happen in anim_poll, called
+ * from the game loop or the input idle hook, so animations never
+ * block input and never touch SPI from an interrupt.
+ */
+
+#ifndef ANIMATION_H_
+#define ANIMATION_H_
+
+#include "mbed.h"
+#include "framebuffer.h"
+
+
+/*---------------------------------------------------------------
+  Animation constants
+ *---------------------------------------------------------------*/
+
+// Frames per second
+#define ANIM_FPS 20
+
+// Most animations waiting to play
+#define ANIM_QUEUE 4
+
+
+/*---------------------------------------------------------------
+  Animation functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Sets the framebuffer animations draw into. Its devices are
+ * treated as a strip, device 1 leftmost.
+ */
+void init_anim(framebuffer_t* fb);
+
+/**
+ * Queues flashing every LED on and off the given number of times,
+ * each phase lasting the given number of frames. Returns false if
+ * the queue is full.
+ */
+bool anim_blink(int times, int frames);
+
+/**
+ * Queues lighting each LED in turn, digit by digit. Returns false
+ * if the queue is full.
+ */
+bool anim_sweep();
+
+/**
+ * Queues scrolling text right to left across the strip, one column
+ * per frame. Letters, digits, spaces and '!' are drawn; anything
+ * else shows as a space. The text must stay valid until it has
+ * played. Returns false if the queue is full.
+ */
+bool anim_scroll(const char* text);
+
+/**
+ * Draws and flushes the current frame if one is due. Returns true
+ * if it did, so it can be chained into an idle function.
+ */
+bool anim_poll();
+
+/**
+ * Returns true while animations are queued or playing.
+ */
+bool anim_busy();
+
+/**
+ * Drops every queued animation and blanks the framebuffer.
+ */
+void anim_stop();
+
+#endif /* ANIMATION_H_ */
@@ -0,0 +1,68 @@
+/*
+ * bench.cpp
+ *
+ */
+
+#include "bench.h"
+
+/*---------------------------------------------------------------
+  Layout benchmark
+ *---------------------------------------------------------------*/
+
+// Cells per millisecond
+static int per_ms(size_t cells, int us) {
+	return (int) ((uint64_t) cells * 1000 / us);
+}
+
+
+// Generates and solves one maze, returning its path length or -1
+static int bench_one(int size, layout order) {
+	const char* name = order == LAYOUT_ROWS ? "rows" : "tiled";
+	size_t cells = (size_t) size * size;
+
+	maze_t* maze = new_maze_layout(size, size, order);
+	if (maze == NULL) {
+		out_printf("  %dx%d %s: out of memory\n", size, size, name);
+		return -1;
+	}
+
+	srand(size);
+	Timer gen_time;
+	gen_time.start();
+	int gen_result = generate(maze);
+	gen_time.stop();
+
+	Timer solve_time;
+	solve_time.start();
+	int length = gen_result == 0 ? path_length(maze) : -1;
+	solve_time.stop();
+
+	// Where the timers did not run, as on the host, only the path
+	// length is shown; maze_bench times the layouts there
+	int gen_us = gen_time.read_us();
+	int solve_us = solve_time.read_us();
+	if (length >= 0 && gen_us > 0 && solve_us > 0) {
+		out_printf("  %dx%d %s: path %d, generate %d cells/ms, solve %d cells/ms\n",
+			size, size, name, length, per_ms(cells, gen_us), per_ms(cells, solve_us));
+	} else if (length >= 0) {
+		out_printf("  %dx%d %s: path %d\n", size, size, name, length);
+	} else {
+		out_printf("  %dx%d %s: failed\n", size, size, name);
+	}
+
+	free_maze(maze);
+	return length;
+}
+
+
+// Runs both layouts at every size
+bool bench_layouts(int min_size, int max_size) {
+	for (int size = min_size; size <= max_size; size *= 2) {
+		int rows = bench_one(size, LAYOUT_ROWS);
+		int tiled = bench_one(size, LAYOUT_TILED);
+		if (rows < 0 || rows != tiled) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,29 @@
+/*
+ * bench.h
+ *
+ * Throughput benchmarks. Results are printed through out_printf,
+ * one line per measurement.
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include "mbed.h"
+#include "maze.h"
+#include "output.h"
+
+
+/*---------------------------------------------------------------
+  Bench functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Compares generation and solve throughput of row-major and tiled
+ * cell layouts on square mazes, doubling the side from min_size up
+ * to max_size. Throughput is only printed where Timer runs. Both layouts get the same seed, so they build the same
+ * maze and must agree on its path length. Returns false if they do
+ * not, or if a maze could not be allocated.
+ */
+bool bench_layouts(int min_size, int max_size);
+
+#endif /* BENCH_H_ */
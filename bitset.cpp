@@ -0,0 +1,61 @@
+/*
+ * bitset.cpp
+ *
+ */
+
+#include "bitset.h"
+
+/*---------------------------------------------------------------
+  Bitset functions
+ *---------------------------------------------------------------*/
+
+// Grows the word array if needed and clears the used part
+bool bitset_reset(bitset_t* set, size_t bits) {
+	size_t words = (bits + 31) / 32;
+	if (words > set->capacity) {
+		uint32_t* grown = (uint32_t*) realloc(set->words, words * sizeof(uint32_t));
+		if (grown == NULL) {
+			return false;
+		}
+		set->words = grown;
+		set->capacity = words;
+	}
+
+	if (words > 0) {
+		memset(set->words, 0, words * sizeof(uint32_t));
+	}
+	set->bits = bits;
+	return true;
+}
+
+
+// Releases the word array
+void bitset_free(bitset_t* set) {
+	free(set->words);
+	set->words = NULL;
+	set->bits = 0;
+	set->capacity = 0;
+}
+
+
+// Skips whole words of set bits, then finds the lowest clear bit
+// of the first word that has one
+size_t bitset_next_clear(const bitset_t* set, size_t from) {
+	if (from >= set->bits) {
+		return set->bits;
+	}
+
+	size_t w = from >> 5;
+	uint32_t free_bits = ~set->words[w] & (0xFFFFFFFFu << (from & 31));
+	size_t words = (set->bits + 31) / 32;
+
+	while (free_bits == 0) {
+		if (++w == words) {
+			return set->bits;
+		}
+		free_bits = ~set->words[w];
+	}
+
+	size_t i = (w << 5) + __builtin_ctz(free_bits);
+	return i < set->bits ? i : set->bits;
+}
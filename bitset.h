@@ -0,0 +1,65 @@
+/*
+ * bitset.h
+ *
+ * Dense bitsets for visited tracking, one bit per cell. A bitset
+ * keeps its allocation when reset to the same or a smaller size, so
+ * one can be reused across calls without reallocating.
+ */
+
+#ifndef BITSET_H_
+#define BITSET_H_
+
+#include "mbed.h"
+
+
+/*---------------------------------------------------------------
+  Bitset types
+ *---------------------------------------------------------------*/
+
+/**
+ * Type of a bitset. Zero-initialise before the first bitset_reset.
+ */
+typedef struct {
+	uint32_t* words;
+	size_t bits;
+	size_t capacity;
+} bitset_t;
+
+
+
+/*---------------------------------------------------------------
+  Bitset functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Sizes a bitset to hold the given number of bits, all clear. Only
+ * reallocates if it is growing. Returns false if out of memory.
+ */
+bool bitset_reset(bitset_t* set, size_t bits);
+
+/**
+ * Releases the memory of a bitset.
+ */
+void bitset_free(bitset_t* set);
+
+/**
+ * Returns the index of the first clear bit at or after from, or the
+ * size of the set if all of them are set.
+ */
+size_t bitset_next_clear(const bitset_t* set, size_t from);
+
+/**
+ * Returns whether a bit is set.
+ */
+inline bool bitset_get(const bitset_t* set, size_t i) {
+	return (set->words[i >> 5] >> (i & 31)) & 1;
+}
+
+/**
+ * Sets a bit.
+ */
+inline void bitset_set(bitset_t* set, size_t i) {
+	set->words[i >> 5] |= 1u << (i & 31);
+}
+
+#endif /* BITSET_H_ */
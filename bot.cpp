@@ -0,0 +1,304 @@
+/*
+ * bot.cpp
+ *
+ */
+
+#include "bot.h"
+
+/*---------------------------------------------------------------
+  Constants
+ *---------------------------------------------------------------*/
+
+// Number of per-move latency samples kept for percentiles
+#define BOT_SAMPLES 1024
+
+static uint32_t samples[BOT_SAMPLES];
+
+
+/*---------------------------------------------------------------
+  Utility functions
+ *---------------------------------------------------------------*/
+
+// Keystroke for a direction, the inverse of interpret
+static char key_of(direction dir) {
+	switch (dir) {
+	case NORTH: return 'w';
+	case SOUTH: return 's';
+	case EAST: 	return 'd';
+	case WEST: 	return 'a';
+	default: 	return ' ';
+	}
+}
+
+
+// Direction a quarter turn clockwise from dir
+static direction right_of(direction dir) {
+	switch (dir) {
+	case NORTH: return EAST;
+	case EAST: 	return SOUTH;
+	case SOUTH: return WEST;
+	case WEST: 	return NORTH;
+	default: 	return NONE;
+	}
+}
+
+
+// Cell the player is standing on
+static cell current_cell(state_t* state) {
+	return maze_at(state->maze, state->curr_pos.x, state->curr_pos.y);
+}
+
+
+// Sort order for latency samples
+static int compare_samples(const void* a, const void* b) {
+	uint32_t x = *(const uint32_t*) a;
+	uint32_t y = *(const uint32_t*) b;
+	return (x > y) - (x < y);
+}
+
+
+/*---------------------------------------------------------------
+  Strategies
+ *---------------------------------------------------------------*/
+
+// Presses a random direction key, walls or not
+static direction random_walk() {
+	direction dir[] = {NORTH, SOUTH, EAST, WEST};
+	return dir[rand() % 4];
+}
+
+
+// Keeps the right hand on the wall
+static direction wall_follow(bot_t* bot, state_t* state) {
+	cell curr = current_cell(state);
+
+	// Try right, straight, left, then back
+	direction d = right_of(bot->heading);
+	for (int i = 0; i < 4; i++) {
+		if (can_move(d, curr)) {
+			bot->heading = d;
+			return d;
+		}
+		d = right_of(opposite(d));
+	}
+	return NONE;
+}
+
+
+// Tremaux marks of the four passages around a cell
+static uint8_t* marks_at(bot_t* bot, maze_t* maze, point_t p) {
+	return &bot->marks[(p.y * maze->width + p.x) * 4];
+}
+
+
+// Tremaux's algorithm: never walk a passage more than twice,
+// preferring passages that have not been walked yet
+static direction tremaux(bot_t* bot, state_t* state) {
+	point_t p = state->curr_pos;
+	cell curr = current_cell(state);
+	uint8_t* marks = marks_at(bot, state->maze, p);
+	direction back = opposite(bot->heading);
+
+	direction best = NONE;
+	for (int d = NORTH; d <= WEST; d++) {
+		direction dir = (direction) d;
+		if (!can_move(dir, curr) || marks[dir] >= 2) {
+			continue;
+		}
+		if (best == NONE || marks[dir] < marks[best] ||
+			(marks[dir] == marks[best] && best == back))
+		{
+			best = dir;
+		}
+	}
+
+	if (best != NONE) {
+		point_t next = p;
+		step(best, &next);
+		marks[best] += 1;
+		marks_at(bot, state->maze, next)[opposite(best)] += 1;
+		bot->heading = best;
+	}
+	return best;
+}
+
+
+// Follows the distance field down to the exit
+static direction solve(bot_t* bot, state_t* state) {
+	int width = state->maze->width;
+	point_t p = state->curr_pos;
+	cell curr = current_cell(state);
+
+	for (int d = NORTH; d <= WEST; d++) {
+		direction dir = (direction) d;
+		point_t next = p;
+		step(dir, &next);
+		if (can_move(dir, curr) &&
+			bot->dist[next.y * width + next.x] < bot->dist[p.y * width + p.x])
+		{
+			return dir;
+		}
+	}
+	return NONE;
+}
+
+
+// Breadth-first search out from the exit. Returns false if there
+// is no memory for the queue.
+static bool fill_distances(bot_t* bot, maze_t* maze) {
+	int width = maze->width;
+	int size = maze->width * maze->height;
+	point_t* queue = (point_t*) malloc(size * sizeof(point_t));
+	if (queue == NULL) {
+		return false;
+	}
+	int head = 0;
+	int tail = 0;
+
+	for (int i = 0; i < size; i++) {
+		bot->dist[i] = (uint) -1;
+	}
+	bot->dist[maze->exit.y * width + maze->exit.x] = 0;
+	queue[tail++] = maze->exit;
+
+	while (head < tail) {
+		point_t p = queue[head++];
+		cell curr = maze_at(maze, p.x, p.y);
+		for (int d = NORTH; d <= WEST; d++) {
+			direction dir = (direction) d;
+			point_t next = p;
+			step(dir, &next);
+			if (can_move(dir, curr) && bot->dist[next.y * width + next.x] == (uint) -1) {
+				bot->dist[next.y * width + next.x] = bot->dist[p.y * width + p.x] + 1;
+				queue[tail++] = next;
+			}
+		}
+	}
+
+	free(queue);
+	return true;
+}
+
+
+/*---------------------------------------------------------------
+  Bot functions
+ *---------------------------------------------------------------*/
+
+// Printable name of a strategy
+const char* bot_name(bot_kind kind) {
+	switch (kind) {
+	case BOT_RANDOM: 		return "random walk";
+	case BOT_WALL_FOLLOWER: return "wall follower";
+	case BOT_TREMAUX: 		return "tremaux";
+	case BOT_SOLVER: 		return "solver";
+	default: 				return "unknown";
+	}
+}
+
+
+// Sets up bot memory for a new maze
+bool init_bot(bot_t* bot, bot_kind kind, state_t* state) {
+	int size = state->maze->width * state->maze->height;
+
+	bot->kind = kind;
+	bot->heading = SOUTH;
+	bot->marks = NULL;
+	bot->dist = NULL;
+
+	if (kind == BOT_TREMAUX) {
+		bot->marks = (uint8_t*) calloc(size * 4, sizeof(uint8_t));
+		return bot->marks != NULL;
+	}
+	if (kind == BOT_SOLVER) {
+		bot->dist = (uint*) malloc(size * sizeof(uint));
+		if (bot->dist == NULL || !fill_distances(bot, state->maze)) {
+			free_bot(bot);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// Releases bot memory
+void free_bot(bot_t* bot) {
+	free(bot->marks);
+	free(bot->dist);
+	bot->marks = NULL;
+	bot->dist = NULL;
+}
+
+
+// Picks the next key to type
+char bot_key(bot_t* bot, state_t* state) {
+	switch (bot->kind) {
+	case BOT_RANDOM: 		return key_of(random_walk());
+	case BOT_WALL_FOLLOWER: return key_of(wall_follow(bot, state));
+	case BOT_TREMAUX: 		return key_of(tremaux(bot, state));
+	case BOT_SOLVER: 		return key_of(solve(bot, state));
+	default: 				return ' ';
+	}
+}
+
+
+// Load-test harness
+void run_bot(bot_kind kind, int seed, uint rounds, uint max_moves, bot_show_t show,
+		bot_stats_t* stats) {
+	static bot_t bot;
+	Timer total;
+	Timer move;
+	uint sampled = 0;
+
+	memset(stats, 0, sizeof(bot_stats_t));
+	stats->rounds = rounds;
+
+	for (uint round = 0; round < rounds; round++) {
+		// Rounds without memory for the maze or the bot are skipped
+		srand(seed + round);
+		state_t* state = init_state();
+		if (state == NULL) {
+			continue;
+		}
+		if (!init_bot(&bot, kind, state)) {
+			free_state(state);
+			continue;
+		}
+		if (show != NULL) {
+			show(state, 0, MOVE_OK);
+		}
+
+		total.start();
+		for (uint i = 0; i < max_moves && !state->game_complete; i++) {
+			move.reset();
+			move.start();
+			char key = bot_key(&bot, state);
+			move_result result = apply_input(key, state);
+			if (show != NULL) {
+				show(state, key, result);
+			}
+			move.stop();
+
+			samples[sampled % BOT_SAMPLES] = move.read_us();
+			sampled++;
+			stats->moves++;
+		}
+		total.stop();
+
+		if (state->game_complete) {
+			stats->completed++;
+		}
+		free_bot(&bot);
+		free_state(state);
+	}
+
+	stats->elapsed_us = total.read_us();
+
+	// Percentiles over the most recent samples
+	uint n = sampled < BOT_SAMPLES ? sampled : BOT_SAMPLES;
+	if (n > 0) {
+		qsort(samples, n, sizeof(uint32_t), compare_samples);
+		stats->p50_us = samples[n * 50 / 100];
+		stats->p90_us = samples[n * 90 / 100];
+		stats->p99_us = samples[n * 99 / 100];
+	}
+}
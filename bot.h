@@ -0,0 +1,101 @@
+/*
+ * bot.h
+ *
+ * Autoplayer bots and a load-test harness that drives the game
+ * through the same WASD keystrokes a player would type.
+ */
+
+#ifndef BOT_H_
+#define BOT_H_
+
+#include "mbed.h"
+#include "maze.h"
+#include "game.h"
+
+
+/*---------------------------------------------------------------
+  Bot types
+ *---------------------------------------------------------------*/
+
+/**
+ * The available playing strategies.
+ */
+enum bot_kind {BOT_RANDOM, BOT_WALL_FOLLOWER, BOT_TREMAUX, BOT_SOLVER};
+
+/**
+ * Type of a bot player. Holds whatever memory its strategy needs
+ * for the maze it is currently playing.
+ */
+typedef struct {
+	bot_kind kind;
+
+	// Wall follower: direction of the last step
+	direction heading;
+
+	// Tremaux: number of times each passage was walked (0-2),
+	// four entries per cell
+	uint8_t* marks;
+
+	// Solver: distance of each cell from the exit
+	uint* dist;
+} bot_t;
+
+/**
+ * Results of a harness run.
+ */
+typedef struct {
+	uint rounds;
+	uint completed;
+	uint moves;
+	uint elapsed_us;
+	uint p50_us;
+	uint p90_us;
+	uint p99_us;
+} bot_stats_t;
+
+/**
+ * Draws a move the way the game does. Called with key 0 before the
+ * first move of each round, then with every key and its result.
+ */
+typedef void (*bot_show_t)(state_t* state, char key, move_result result);
+
+
+
+/*---------------------------------------------------------------
+  Bot functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Returns a printable name for a bot kind.
+ */
+const char* bot_name(bot_kind kind);
+
+/**
+ * Prepares a bot to play the maze in state.
+ * Returns false if out of memory, with nothing left allocated.
+ */
+bool init_bot(bot_t* bot, bot_kind kind, state_t* state);
+
+/**
+ * Frees the memory a bot allocated for its maze.
+ */
+void free_bot(bot_t* bot);
+
+/**
+ * Returns the next keystroke ('w', 'a', 's' or 'd') the bot types.
+ */
+char bot_key(bot_t* bot, state_t* state);
+
+/**
+ * Plays a bot through a number of rounds, seeding round i with
+ * seed + i, giving up on a round after max_moves keystrokes. Rounds
+ * there is no memory for are skipped and not completed. Records
+ * throughput, per-move latency percentiles and completion counts.
+ * If show is not NULL every move is drawn with it, and timed with
+ * it, so the figures cover the prompt and rendering as in play();
+ * otherwise only the keystroke path is timed.
+ */
+void run_bot(bot_kind kind, int seed, uint rounds, uint max_moves, bot_show_t show,
+	bot_stats_t* stats);
+
+#endif /* BOT_H_ */
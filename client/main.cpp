@@ -0,0 +1,73 @@
+/*
+ * main.cpp
+ *
+ * Command line front end for the host client: starts a maze on a
+ * board, or on the host maze server when DEVICE is its socket, from
+ * a seed, plays a string of move keys and prints every status that
+ * comes back.
+ *
+ * Usage: maze_client DEVICE SEED [KEYS] [BAUD]
+ */
+
+#include "maze_client.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+/*---------------------------------------------------------------
+  Utility functions
+ *---------------------------------------------------------------*/
+
+// One status line: request, position, turns and flags
+static void print_status(const char* request, const proto_status_t* status) {
+	printf("%-5s x %u y %u turns %u%s%s%s%s\n", request,
+		status->x, status->y, status->turns,
+		(status->flags & PROTO_BLOCKED) ? " blocked" : "",
+		(status->flags & PROTO_WON) ? " won" : "",
+		(status->flags & PROTO_INVALID) ? " invalid" : "",
+		(status->flags & PROTO_ERROR) ? " error" : "");
+}
+
+
+/*---------------------------------------------------------------
+  Main
+ *---------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s DEVICE SEED [KEYS] [BAUD]\n", argv[0]);
+		return 2;
+	}
+	const char* keys = argc > 3 ? argv[3] : "";
+	int baud = argc > 4 ? atoi(argv[4]) : 9600;
+
+	maze_client_t client;
+	struct stat info;
+	bool server = stat(argv[1], &info) == 0 && S_ISSOCK(info.st_mode);
+	if ((server ? client_connect(&client, argv[1]) : client_open(&client, argv[1], baud)) != 0) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	proto_status_t status;
+	if (client_start(&client, (int32_t) strtol(argv[2], NULL, 0), &status) != 0) {
+		fprintf(stderr, "%s: no answer to start\n", argv[1]);
+		client_close(&client);
+		return 1;
+	}
+	print_status("start", &status);
+
+	for (const char* key = keys; *key != '\0'; key++) {
+		char request[2] = {*key, '\0'};
+		if (client_move(&client, *key, &status) != 0) {
+			fprintf(stderr, "%s: no answer to %s\n", argv[1], request);
+			client_close(&client);
+			return 1;
+		}
+		print_status(request, &status);
+	}
+
+	client_close(&client);
+	return (status.flags & PROTO_ERROR) ? 1 : 0;
+}
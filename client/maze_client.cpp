@@ -0,0 +1,148 @@
+/*
+ * maze_client.cpp
+ *
+ */
+
+#include "maze_client.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------
+  Utility functions
+ *---------------------------------------------------------------*/
+
+// termios constant for a baud rate
+static speed_t speed_of(int baud) {
+	switch (baud) {
+	case 9600: 	 return B9600;
+	case 19200:  return B19200;
+	case 38400:  return B38400;
+	case 57600:  return B57600;
+	case 115200: return B115200;
+	default: 	 return B9600;
+	}
+}
+
+
+// Sends a request payload and waits for the status frame
+static int request(maze_client_t* client, const uint8_t* payload, size_t len,
+		proto_status_t* status) {
+	uint8_t frame[PROTO_MAX_FRAME];
+	size_t frame_len = proto_encode(payload, len, frame);
+	if (frame_len == 0 || write(client->fd, frame, frame_len) != (ssize_t) frame_len) {
+		return -1;
+	}
+
+	uint8_t byte;
+	while (read(client->fd, &byte, 1) == 1) {
+		if (proto_feed(&client->parser, byte) == 1) {
+			return proto_unpack_status(client->parser.payload, client->parser.len, status);
+		}
+	}
+	return -1;
+}
+
+
+/*---------------------------------------------------------------
+  Client functions
+ *---------------------------------------------------------------*/
+
+// Opens the serial device in raw mode
+int client_open(maze_client_t* client, const char* device, int baud) {
+	client->fd = open(device, O_RDWR | O_NOCTTY);
+	if (client->fd < 0) {
+		return -1;
+	}
+
+	struct termios tty;
+	if (tcgetattr(client->fd, &tty) != 0) {
+		close(client->fd);
+		return -1;
+	}
+	cfmakeraw(&tty);
+	cfsetispeed(&tty, speed_of(baud));
+	cfsetospeed(&tty, speed_of(baud));
+
+	// Give up on a read after a second of silence
+	tty.c_cc[VMIN] = 0;
+	tty.c_cc[VTIME] = 10;
+
+	if (tcsetattr(client->fd, TCSANOW, &tty) != 0) {
+		close(client->fd);
+		return -1;
+	}
+	tcflush(client->fd, TCIOFLUSH);
+
+	proto_reset(&client->parser);
+	return 0;
+}
+
+
+// Connects to the server's socket
+int client_connect(maze_client_t* client, const char* path) {
+	struct sockaddr_un addr;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	client->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (client->fd < 0) {
+		return -1;
+	}
+
+	// Give up on a read after a second of silence, as on a tty
+	struct timeval timeout = {1, 0};
+	if (setsockopt(client->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+		connect(client->fd, (struct sockaddr*) &addr, sizeof(addr)) != 0)
+	{
+		close(client->fd);
+		client->fd = -1;
+		return -1;
+	}
+
+	proto_reset(&client->parser);
+	return 0;
+}
+
+
+// Takes over an open descriptor
+void client_attach(maze_client_t* client, int fd) {
+	client->fd = fd;
+	proto_reset(&client->parser);
+}
+
+
+// Closes the serial device
+void client_close(maze_client_t* client) {
+	if (client->fd >= 0) {
+		close(client->fd);
+		client->fd = -1;
+	}
+}
+
+
+// Starts a new maze
+int client_start(maze_client_t* client, int32_t seed, proto_status_t* status) {
+	uint8_t payload[5];
+	payload[0] = PROTO_START;
+	payload[1] = seed & 0xFF;
+	payload[2] = (seed >> 8) & 0xFF;
+	payload[3] = (seed >> 16) & 0xFF;
+	payload[4] = (seed >> 24) & 0xFF;
+	return request(client, payload, sizeof(payload), status);
+}
+
+
+// Makes one move
+int client_move(maze_client_t* client, char key, proto_status_t* status) {
+	uint8_t payload = (uint8_t) key;
+	return request(client, &payload, 1, status);
+}
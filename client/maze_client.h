@@ -0,0 +1,69 @@
+/*
+ * maze_client.h
+ *
+ * Host-side client for the binary serial protocol, to a board's
+ * serial device or to the host maze server. Builds on Linux and
+ * macOS, not on the board.
+ */
+
+#ifndef MAZE_CLIENT_H_
+#define MAZE_CLIENT_H_
+
+#include "protocol.h"
+
+
+/*---------------------------------------------------------------
+  Client types
+ *---------------------------------------------------------------*/
+
+/**
+ * Type of a connection to a board.
+ */
+typedef struct {
+	int fd;
+	proto_parser_t parser;
+} maze_client_t;
+
+
+
+/*---------------------------------------------------------------
+  Client functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Opens the board's serial device in raw mode at the given baud
+ * rate. The game switches to binary mode on the first request, so
+ * it must be sitting at the seed prompt.
+ * Returns 0 on success, -1 on error.
+ */
+int client_open(maze_client_t* client, const char* device, int baud);
+
+/**
+ * Connects to a maze server listening on a Unix domain socket.
+ * Returns 0 on success, -1 on error.
+ */
+int client_connect(maze_client_t* client, const char* path);
+
+/**
+ * Uses a descriptor that is already open to a board or a server,
+ * such as a socket, as the connection. The client closes it.
+ */
+void client_attach(maze_client_t* client, int fd);
+
+/**
+ * Closes the connection.
+ */
+void client_close(maze_client_t* client);
+
+/**
+ * Starts a new maze from a seed. Returns 0 on success, -1 on error.
+ */
+int client_start(maze_client_t* client, int32_t seed, proto_status_t* status);
+
+/**
+ * Sends one move key ('w', 'a', 's' or 'd').
+ * Returns 0 on success, -1 on error.
+ */
+int client_move(maze_client_t* client, char key, proto_status_t* status);
+
+#endif /* MAZE_CLIENT_H_ */
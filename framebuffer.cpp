@@ -0,0 +1,128 @@
+/*
+ * framebuffer.cpp
+ *
+ */
+
+#include "framebuffer.h"
+
+/*---------------------------------------------------------------
+  Utility functions
+ *---------------------------------------------------------------*/
+
+// Sends one digit of every device. With asynchronous SPI the frame
+// goes out in the background: the next one sleeps until it is done,
+// so the CPU is free while the last frame of a flush is on the wire.
+// A transfer that cannot start is sent the blocking way instead.
+static void send_digit(framebuffer_t* fb, uint8_t digit, const uint8_t* data) {
+#if DEVICE_SPI_ASYNCH
+	if (fb->display->write_digit_all_async(digit, data, fb->devices) == 0) {
+		return;
+	}
+#endif
+	fb->display->write_digit_all(digit, data, fb->devices);
+}
+
+
+/*---------------------------------------------------------------
+  Framebuffer functions
+ *---------------------------------------------------------------*/
+
+// Starts blank and out of sync
+void fb_init(framebuffer_t* fb, Max7219* display, uint8_t devices) {
+	fb->display = display;
+	fb->devices = devices < FB_DEVICES ? devices : FB_DEVICES;
+	memset(fb->orient, ORIENT_NORMAL, sizeof(fb->orient));
+	fb_clear(fb);
+	fb_invalidate(fb);
+}
+
+
+// Changes how one device's frames are mapped to its wiring
+void fb_orient(framebuffer_t* fb, uint8_t device, uint8_t orient) {
+	if (device == 0 || device > fb->devices) {
+		return;
+	}
+	fb->orient[device - 1] = orient;
+}
+
+
+// Marks the shadow as unknown
+void fb_invalidate(framebuffer_t* fb) {
+	fb->synced = false;
+}
+
+
+// Fills every row
+void fb_fill(framebuffer_t* fb, uint8_t bits) {
+	memset(fb->wanted, bits, sizeof(fb->wanted));
+}
+
+
+// Blanks every row
+void fb_clear(framebuffer_t* fb) {
+	fb_fill(fb, 0);
+}
+
+
+// Sets or clears one bit
+void fb_set(framebuffer_t* fb, uint8_t device, int x, int y, bool on) {
+	if (device == 0 || device > fb->devices || x < 0 || x > 7 || y < 0 || y > 7) {
+		return;
+	}
+
+	if (on) {
+		fb->wanted[device - 1][x] |= 1 << y;
+	} else {
+		fb->wanted[device - 1][x] &= ~(1 << y);
+	}
+}
+
+
+// Sets one digit
+void fb_row(framebuffer_t* fb, uint8_t device, int x, uint8_t bits) {
+	if (device == 0 || device > fb->devices || x < 0 || x > 7) {
+		return;
+	}
+	fb->wanted[device - 1][x] = bits;
+}
+
+
+// Writes each changed digit of the whole chain in one frame
+int fb_flush(framebuffer_t* fb) {
+	int frames = 0;
+
+	// Map every device to its wiring first
+	uint8_t sent[FB_DEVICES][8];
+	for (int d = 0; d < fb->devices; d++) {
+		if (fb->orient[d] == ORIENT_NORMAL) {
+			memcpy(sent[d], fb->wanted[d], 8);
+		} else {
+			frame_unpack(frame_orient(frame_pack(fb->wanted[d]), fb->orient[d]), sent[d]);
+		}
+	}
+
+	for (int x = 0; x < 8; x++) {
+		uint8_t data[FB_DEVICES];
+		bool changed = !fb->synced;
+
+		for (int d = 0; d < fb->devices; d++) {
+			data[d] = sent[d][x];
+			changed = changed || data[d] != fb->shown[d][x];
+			fb->shown[d][x] = data[d];
+		}
+
+		if (changed) {
+			send_digit(fb, Max7219::MAX7219_DIGIT_0 + x, data);
+			frames++;
+		}
+	}
+
+	fb->synced = true;
+	return frames;
+}
+
+
+// Lets the last asynchronous frame finish
+void fb_wait(framebuffer_t* fb) {
+	fb->display->wait_idle();
+}
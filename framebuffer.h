@@ -0,0 +1,111 @@
+/*
+ * framebuffer.h
+ *
+ * Shadow copy of the digit registers of a chain of Max7219 devices.
+ * Drawing only changes memory; fb_flush sends the rows that differ
+ * from what the devices already show.
+ */
+
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+#include "mbed.h"
+#include "max7219.h"
+#include "transform.h"
+
+
+/*---------------------------------------------------------------
+  Framebuffer constants
+ *---------------------------------------------------------------*/
+
+// Most devices a framebuffer can drive
+#define FB_DEVICES 8
+
+
+/*---------------------------------------------------------------
+  Framebuffer types
+ *---------------------------------------------------------------*/
+
+/**
+ * One bit per LED of every device: digit bytes indexed by device
+ * from 0, then by digit.
+ */
+typedef uint8_t fb_plane_t[FB_DEVICES][8];
+
+/**
+ * Type of a framebuffer. Rows are indexed by device, numbered from
+ * 1 as in the driver but stored from 0, then by digit. Bit y of
+ * digit x lights the LED at (x, y) as drawn; each device's
+ * orientation maps that to its wiring when flushing, so shown holds
+ * what was actually sent.
+ */
+typedef struct {
+	Max7219* display;
+	uint8_t devices;
+	bool synced;
+	uint8_t orient[FB_DEVICES];
+	fb_plane_t wanted;
+	fb_plane_t shown;
+} framebuffer_t;
+
+
+
+/*---------------------------------------------------------------
+  Framebuffer functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Sets up a blank framebuffer over the first devices of a display.
+ * The first flush sends every row, since what the devices show is
+ * not known yet.
+ */
+void fb_init(framebuffer_t* fb, Max7219* display, uint8_t devices);
+
+/**
+ * Sets how a device is mounted, as ORIENT_ flags. Drawing stays in
+ * the same coordinates; the next flush sends the transformed frame.
+ */
+void fb_orient(framebuffer_t* fb, uint8_t device, uint8_t orient);
+
+/**
+ * Forgets what the devices show, so the next flush sends every row.
+ * Use after writing to the display without the framebuffer.
+ */
+void fb_invalidate(framebuffer_t* fb);
+
+/**
+ * Sets every row of every device to the same bits.
+ */
+void fb_fill(framebuffer_t* fb, uint8_t bits);
+
+/**
+ * Turns every LED off.
+ */
+void fb_clear(framebuffer_t* fb);
+
+/**
+ * Turns the LED at (x, y) of a device on or off. Out of range
+ * arguments are ignored.
+ */
+void fb_set(framebuffer_t* fb, uint8_t device, int x, int y, bool on);
+
+/**
+ * Sets a whole digit of a device. Out of range arguments are
+ * ignored.
+ */
+void fb_row(framebuffer_t* fb, uint8_t device, int x, uint8_t bits);
+
+/**
+ * Sends the digits that changed on any device since the last flush,
+ * all devices of a digit in one frame. Returns the number of
+ * chip-select frames sent. Where SPI is asynchronous the last frame
+ * may still be going out on return; see fb_wait.
+ */
+int fb_flush(framebuffer_t* fb);
+
+/**
+ * Waits until every frame fb_flush sent is out.
+ */
+void fb_wait(framebuffer_t* fb);
+
+#endif /* FRAMEBUFFER_H_ */
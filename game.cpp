@@ -28,16 +28,115 @@ void take_step (direction x, state_t* state) {
 }
 
 
+// Applies a keystroke to the game state
+move_result apply_input(char c, state_t* state) {
+	direction d = interpret(c);
+	if (d == NONE) {
+		return MOVE_INVALID;
+	}
+
+	state->turns = state->turns + 1;
+
+	point_t curr_p = state->curr_pos;
+	if (!can_move(d, maze_at(state->maze, curr_p.x, curr_p.y))) {
+		return MOVE_BLOCKED;
+	}
+
+	take_step(d, state);
+
+	if (points_equal(state->curr_pos, state->maze->exit)) {
+		state->game_complete = 1;
+		return MOVE_WON;
+	}
+	return MOVE_OK;
+}
+
+
 // Initializes state
 state_t* init_state() {
 	state_t* state = (state_t*) malloc(sizeof(state_t));
-	maze_t* game_maze = init();
+	maze_t* game_maze = take_maze(WIDTH, HEIGHT);
+	if (state == NULL || game_maze == NULL) {
+		free(state);
+		free_maze(game_maze);
+		return NULL;
+	}
 	
 	state->maze = game_maze;
-	point_t start = {0, 0};
-	state->curr_pos = start;
+	state->curr_pos = game_maze->start;
 	state->game_complete = 0;
 	state->turns = 0;
 
 	return state;
 }
+
+
+// Frees state and its maze
+void free_state(state_t* state) {
+	if (state != NULL) {
+		free_maze(state->maze);
+		free(state);
+	}
+}
+
+
+
+/*---------------------------------------------------------------
+  Next maze functions
+ *---------------------------------------------------------------*/
+
+// Time given to each prepare_step slice
+#define PREPARE_SLICE_US 500
+
+// The maze being prepared and its generator. After srand the
+// sequence of mazes is fixed, and nothing else calls rand() while
+// a round is played, so preparing the next one early gives the
+// same maze as generating it when the round starts.
+static maze_t* spare = NULL;
+static gen_t spare_gen;
+
+
+// Allocates the spare and starts its generator. A spare of the same
+// size that was never taken is still the next maze for the seed, so
+// it is kept rather than built again.
+void prepare_maze(int width, int height) {
+	if (spare != NULL && spare->width == width && spare->height == height) {
+		return;
+	}
+	discard_maze();
+	spare = new_maze(width, height);
+	if (spare != NULL && !gen_begin(&spare_gen, spare)) {
+		discard_maze();
+	}
+}
+
+
+// Advances the spare a slice at a time
+bool prepare_step() {
+	if (spare == NULL) {
+		return false;
+	}
+	return !gen_run_for(&spare_gen, PREPARE_SLICE_US);
+}
+
+
+// Hands over the spare if it fits, otherwise generates now
+maze_t* take_maze(int width, int height) {
+	if (spare == NULL || spare->width != width || spare->height != height) {
+		discard_maze();
+		return init_maze(width, height);
+	}
+
+	gen_step(&spare_gen, (size_t) -1);
+	maze_t* maze = spare;
+	spare = NULL;
+	return maze;
+}
+
+
+// Drops the spare, keeping the generator buffers for the next one
+void discard_maze() {
+	free_maze(spare);
+	spare = NULL;
+	spare_gen.top = 0;
+}
@@ -25,6 +25,11 @@ typedef struct {
 	uint turns;
 } state_t;
 
+/**
+ * Outcome of applying a single keystroke to the game state.
+ */
+enum move_result {MOVE_INVALID, MOVE_BLOCKED, MOVE_OK, MOVE_WON};
+
 
 
 /*---------------------------------------------------------------
@@ -38,7 +43,8 @@ direction interpret(char c);
 
 /** 
  * Initializes the game with player's current position 
- * at the start of the maze (0,0). 
+ * at the start of the maze. 
+ * Returns NULL if out of memory.
  */
 state_t* init_state();
 
@@ -49,4 +55,49 @@ state_t* init_state();
  */
 void take_step(direction x, state_t* state);
 
+/**
+ * Applies one keystroke to the game state. Invalid keys leave the
+ * state untouched, any valid direction counts as a turn, and the
+ * game is marked complete once the player reaches the exit.
+ * Does no I/O, so it can be driven by any input source.
+ */
+move_result apply_input(char c, state_t* state);
+
+/**
+ * Frees a state returned by init_state along with its maze.
+ */
+void free_state(state_t* state);
+
+
+
+/*---------------------------------------------------------------
+  Next maze functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Starts generating the next maze of the given size ahead of time,
+ * into a spare buffer. Nothing is carved until prepare_step runs,
+ * typically from the input idle hook. Keeps a maze already being
+ * prepared if it has the same size, otherwise replaces it.
+ */
+void prepare_maze(int width, int height);
+
+/**
+ * Runs one short slice of the maze being prepared. Returns true
+ * while there is more to do, so it can be passed to set_idle.
+ */
+bool prepare_step();
+
+/**
+ * Returns a new maze of the given size: the prepared one, finished
+ * if need be, when its size matches, otherwise a freshly generated
+ * one. The caller owns the result.
+ */
+maze_t* take_maze(int width, int height);
+
+/**
+ * Frees the maze being prepared, if any.
+ */
+void discard_maze();
+
 #endif /* GAME_H_ */
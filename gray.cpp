@@ -0,0 +1,105 @@
+/*
+ * gray.cpp
+ *
+ */
+
+#include "gray.h"
+
+/*---------------------------------------------------------------
+  Plane cycling
+ *---------------------------------------------------------------*/
+
+static fb_plane_t planes[GRAY_PLANES];
+static framebuffer_t* gray_fb;
+static Ticker ticker;
+static volatile bool running = false;
+
+// Plane being shown and units left before the next one
+static volatile int plane = 0;
+static volatile int remaining = 1;
+
+// A plane change is waiting in the event queue
+static volatile bool posted = false;
+
+
+// Event queue: show the current plane. SPI cannot be used from the
+// ticker interrupt, so this runs in the event thread. Where SPI is
+// asynchronous fb_flush returns while the last row is still going
+// out, so the thread is free again that much sooner.
+static void show_plane() {
+	if (running) {
+		memcpy(gray_fb->wanted, planes[plane], sizeof(fb_plane_t));
+		fb_flush(gray_fb);
+	}
+	posted = false;
+}
+
+
+// Ticker interrupt: count units and post plane changes. If the
+// last change has not been shown yet, the next one just replaces it.
+static void on_tick() {
+	remaining = remaining - 1;
+	if (remaining > 0) {
+		return;
+	}
+
+	plane = (plane + 1) % GRAY_PLANES;
+	remaining = 1 << plane;
+	if (!posted) {
+		posted = true;
+		mbed_event_queue()->call(&show_plane);
+	}
+}
+
+
+
+/*---------------------------------------------------------------
+  Grayscale functions
+ *---------------------------------------------------------------*/
+
+// The planes themselves
+fb_plane_t* gray_planes() {
+	return planes;
+}
+
+
+// Blanks every plane
+void gray_clear() {
+	memset(planes, 0, sizeof(planes));
+}
+
+
+// Shows plane 0 now and starts the ticker
+void gray_start(framebuffer_t* fb) {
+	if (running) {
+		return;
+	}
+
+	gray_fb = fb;
+	plane = 0;
+	remaining = 1;
+	running = true;
+	memcpy(gray_fb->wanted, planes[0], sizeof(fb_plane_t));
+	fb_flush(gray_fb);
+	ticker.attach_us(&on_tick, GRAY_UNIT_US);
+}
+
+
+// Stops the ticker, then lets a posted change drain
+void gray_stop() {
+	if (!running) {
+		return;
+	}
+
+	ticker.detach();
+	running = false;
+	while (posted) {
+		wait_ms(1);
+	}
+}
+
+
+// Cycling or not
+bool gray_running() {
+	return running;
+}
@@ -0,0 +1,76 @@
+/*
+ * gray.h
+ *
+ * Grayscale on Max7219 matrices, which only have a global intensity.
+ * Levels are split into bit-planes and plane p is shown for 2^p
+ * time units, so each LED is lit for a share of the cycle equal to
+ * its level out of GRAY_MAX. A Ticker counts the units and posts
+ * each plane change to the shared event queue, which copies the
+ * plane into the framebuffer and flushes only the digits that
+ * differ from the previous plane.
+ *
+ * With the defaults the cycle is 3 units of 1.5 ms, a 222 Hz
+ * refresh. One device at the default 1 MHz SPI clock needs at most
+ * 8 frames of about 26 us per plane change, so worst case about
+ * 9% of the CPU, and much less when few digits differ between
+ * planes. Three planes give 8 levels at 95 Hz.
+ */
+
+#ifndef GRAY_H_
+#define GRAY_H_
+
+#include "mbed.h"
+#include "framebuffer.h"
+
+
+/*---------------------------------------------------------------
+  Grayscale constants
+ *---------------------------------------------------------------*/
+
+// Bit-planes, giving 2^GRAY_PLANES levels
+#define GRAY_PLANES 2
+
+// Brightest level
+#define GRAY_MAX ((1 << GRAY_PLANES) - 1)
+
+// Time the least significant plane is shown
+#define GRAY_UNIT_US 1500
+
+// Time to show every plane once, each for its weight in units
+#define GRAY_CYCLE_US (GRAY_UNIT_US * GRAY_MAX)
+
+
+/*---------------------------------------------------------------
+  Grayscale functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Returns the bit-planes, GRAY_PLANES of them, least significant
+ * first. Draw into them at any time; changes show from the next
+ * plane change.
+ */
+fb_plane_t* gray_planes();
+
+/**
+ * Sets every level to 0.
+ */
+void gray_clear();
+
+/**
+ * Starts cycling the planes through a framebuffer. Nothing else may
+ * flush that framebuffer until gray_stop.
+ */
+void gray_start(framebuffer_t* fb);
+
+/**
+ * Stops cycling and waits for the last plane change to finish. The
+ * framebuffer keeps whatever plane it last showed.
+ */
+void gray_stop();
+
+/**
+ * Returns true between gray_start and gray_stop.
+ */
+bool gray_running();
+
+#endif /* GRAY_H_ */
@@ -0,0 +1,665 @@
+/*
+ * benchmark.cpp
+ *
+ * Host microbenchmarks for the game core and the Max7219 driver.
+ * Prints a table and writes the results as JSON so runs can be
+ * compared between releases:
+ *
+ *     maze_bench [--quick] [results.json]
+ *
+ * Times are wall clock on the host, not the board; bus figures come
+ * from the simulated SPI and match what the board would send.
+ */
+
+#include "mbed.h"
+#include "host.h"
+#include "max7219.h"
+#include "framebuffer.h"
+#include "viewport.h"
+#include "maze.h"
+#include "game.h"
+#include "render.h"
+#include "bot.h"
+#include "treecode.h"
+#include "animation.h"
+#include "output.h"
+#include "show.h"
+#include "term.h"
+#include "gray.h"
+
+#include <time.h>
+
+/*---------------------------------------------------------------
+  Constants
+ *---------------------------------------------------------------*/
+
+// Timed repetitions of each case; the median is reported
+#define BENCH_REPS 7
+#define BENCH_REPS_QUICK 3
+
+// Shortest repetition, operations are doubled until one takes this
+#define BENCH_MIN_NS 50000000ull
+#define BENCH_MIN_NS_QUICK 2000000ull
+
+// Game size used by the larger cases
+#define BIG 64
+#define MID 32
+
+// Precomputed keystrokes for the input case
+#define KEYS 4096
+
+// Rounds of each bot through the game's display path
+#define PLAY_ROUNDS 50
+#define PLAY_ROUNDS_QUICK 5
+#define PLAY_MOVES 2000
+
+// Layout comparison sizes; the largest maze needs about 1 GB
+#define LAYOUT_MIN 64
+#define LAYOUT_MAX 16384
+#define LAYOUT_MAX_QUICK 1024
+
+// Most results in one run
+#define MAX_RESULTS 96
+
+
+/*---------------------------------------------------------------
+  Benchmark types
+ *---------------------------------------------------------------*/
+
+/**
+ * A benchmark case: runs ops operations and returns something
+ * derived from them, so the work cannot be optimized away. Cases
+ * that drive the display give the length of the chain they need.
+ */
+typedef struct {
+	const char* name;
+	const char* unit;
+	uint32_t (*run)(size_t ops);
+	uint8_t devices;
+} bench_case_t;
+
+/**
+ * Measured result of a case.
+ */
+typedef struct {
+	char name[40];
+	const char* unit;
+	size_t ops;
+	double ns_min;
+	double ns_median;
+	double ns_p90;
+	double ns_p99;
+	double spi_bytes;
+	double spi_frames;
+	double wire_ns;
+} bench_result_t;
+
+
+/*---------------------------------------------------------------
+  Fixtures
+ *---------------------------------------------------------------*/
+
+// Same wiring as the board; measure sets the chain length each case
+// asks for, so frames carry no padding for devices it does not use
+static Max7219 chain(PTD2, PTD3, PTD1, PTD0);
+static RawSerial serial(USBTX, USBRX);
+static framebuffer_t frame;
+static viewport_t view;
+
+static maze_t* big_maze;
+static maze_t* mid_maze;
+static state_t walk_state;
+static char keys[KEYS];
+static char* text;
+static uint8_t* code;
+static size_t code_size;
+static size_t code_len;
+
+static volatile uint32_t sink;
+
+
+// Lights a diagonal pattern, enough to give every row some bits
+static int pattern(void* ctx, int x, int y) {
+	return (x + y) % 3 == 0;
+}
+
+
+// Mazes, buffers and the display shared by the cases
+static bool fixtures_begin() {
+	srand(1);
+	big_maze = init_maze(BIG, BIG);
+	mid_maze = init_maze(MID, MID);
+	text = (char*) malloc(render_size(mid_maze));
+	if (big_maze == NULL || mid_maze == NULL || text == NULL) {
+		return false;
+	}
+
+	code_size = tree_bound(mid_maze);
+	code = (uint8_t*) malloc(code_size);
+	code_len = code == NULL ? 0 : tree_encode(mid_maze, code, code_size);
+	if (code_len == 0) {
+		return false;
+	}
+
+	walk_state.maze = big_maze;
+	walk_state.curr_pos = big_maze->start;
+	for (int i = 0; i < KEYS; i++) {
+		keys[i] = "wasd"[rand() % 4];
+	}
+
+	fb_init(&frame, &chain, 4);
+	view_init(&view, &frame, 4, 1, BIG, BIG, &pattern, NULL);
+	host_record(false);
+
+	// The game's output goes through the real queue and port, but
+	// not to the terminal
+	init_output(&serial);
+	init_anim(&frame);
+	show_init(&frame, 4, 1);
+	host_echo(false);
+	return true;
+}
+
+
+static void fixtures_end() {
+	free_maze(big_maze);
+	free_maze(mid_maze);
+	free(text);
+	free(code);
+}
+
+
+/*---------------------------------------------------------------
+  Cases
+ *---------------------------------------------------------------*/
+
+// A default size maze from the seed, as at the start of a round
+static uint32_t run_init(size_t ops) {
+	uint32_t sum = 0;
+	for (size_t i = 0; i < ops; i++) {
+		srand(i);
+		maze_t* maze = init();
+		sum += maze_at(maze, 0, 0);
+		free_maze(maze);
+	}
+	return sum;
+}
+
+
+static uint32_t run_init_big(size_t ops) {
+	uint32_t sum = 0;
+	for (size_t i = 0; i < ops; i++) {
+		srand(i);
+		maze_t* maze = init_maze(BIG, BIG);
+		sum += maze_at(maze, 0, 0);
+		free_maze(maze);
+	}
+	return sum;
+}
+
+
+static uint32_t run_generate_tiled(size_t ops) {
+	uint32_t sum = 0;
+	for (size_t i = 0; i < ops; i++) {
+		srand(i);
+		maze_t* maze = new_maze_layout(BIG, BIG, LAYOUT_TILED);
+		generate(maze);
+		sum += maze_at(maze, 0, 0);
+		free_maze(maze);
+	}
+	return sum;
+}
+
+
+static uint32_t run_path_length(size_t ops) {
+	uint32_t sum = 0;
+	for (size_t i = 0; i < ops; i++) {
+		sum += path_length(big_maze);
+	}
+	return sum;
+}
+
+
+// One whole game, start to exit, per operation
+static uint32_t run_bot_game(bot_kind kind, size_t ops) {
+	static bot_t bot;
+	uint32_t sum = 0;
+	for (size_t i = 0; i < ops; i++) {
+		state_t state = {mid_maze, mid_maze->start, 0, 0};
+		if (!init_bot(&bot, kind, &state)) {
+			fprintf(stderr, "maze_bench: out of memory\n");
+			exit(1);
+		}
+		while (!state.game_complete && state.turns < MID * MID * 8) {
+			apply_input(bot_key(&bot, &state), &state);
+		}
+		sum += state.turns;
+		free_bot(&bot);
+	}
+	return sum;
+}
+
+
+static uint32_t run_wall_follower(size_t ops) {
+	return run_bot_game(BOT_WALL_FOLLOWER, ops);
+}
+
+
+static uint32_t run_tremaux(size_t ops) {
+	return run_bot_game(BOT_TREMAUX, ops);
+}
+
+
+static uint32_t run_solver(size_t ops) {
+	return run_bot_game(BOT_SOLVER, ops);
+}
+
+
+static uint32_t run_render(size_t ops) {
+	uint32_t sum = 0;
+	for (size_t i = 0; i < ops; i++) {
+		sum += render_maze(mid_maze, text, render_size(mid_maze));
+	}
+	return sum;
+}
+
+
+static uint32_t run_tree_encode(size_t ops) {
+	uint32_t sum = 0;
+	for (size_t i = 0; i < ops; i++) {
+		sum += tree_encode(mid_maze, code, code_size);
+	}
+	return sum;
+}
+
+
+static uint32_t run_tree_decode(size_t ops) {
+	uint32_t sum = 0;
+	for (size_t i = 0; i < ops; i++) {
+		maze_t* maze = tree_decode(code, code_len);
+		sum += maze_at(maze, 0, 0);
+		free_maze(maze);
+	}
+	return sum;
+}
+
+
+// Redraws the LED window at alternating places and sends it
+static uint32_t run_led_redraw(size_t ops) {
+	uint32_t sum = 0;
+	for (size_t i = 0; i < ops; i++) {
+		view.left = i & 1;
+		view_redraw(&view);
+		sum += fb_flush(&frame);
+	}
+	fb_wait(&frame);
+	return sum;
+}
+
+
+// Back and forth along the first row; take_step does no wall checks
+static uint32_t run_take_step(size_t ops) {
+	state_t state = {big_maze, big_maze->start, 0, 0};
+	for (size_t i = 0; i < ops; i++) {
+		take_step(i & 1 ? WEST : EAST, &state);
+	}
+	return state.curr_pos.x;
+}
+
+
+// Random keystrokes, through the wall check and win test
+static uint32_t run_apply_input(size_t ops) {
+	uint32_t sum = 0;
+	for (size_t i = 0; i < ops; i++) {
+		sum += apply_input(keys[i % KEYS], &walk_state);
+	}
+	return sum;
+}
+
+
+// One register across the whole chain, changing every time so the
+// cache never skips it
+static uint32_t run_frame_encode(size_t ops) {
+	uint8_t data[FB_DEVICES];
+	for (size_t i = 0; i < ops; i++) {
+		memset(data, (int) i, sizeof(data));
+		chain.write_digit_all(Max7219::MAX7219_DIGIT_0 + (i & 7), data, FB_DEVICES);
+	}
+	return chain.get_frame_count();
+}
+
+
+// Every digit of a four device framebuffer, as after a redraw
+static uint32_t run_full_refresh(size_t ops) {
+	uint32_t sum = 0;
+	for (size_t i = 0; i < ops; i++) {
+		chain.invalidate_cache();
+		fb_invalidate(&frame);
+		sum += fb_flush(&frame);
+	}
+	fb_wait(&frame);
+	return sum;
+}
+
+
+static const bench_case_t cases[] = {
+	{"init_8x8", "maze", &run_init, 0},
+	{"init_maze_64x64", "maze", &run_init_big, 0},
+	{"generate_tiled_64x64", "maze", &run_generate_tiled, 0},
+	{"path_length_64x64", "solve", &run_path_length, 0},
+	{"bot_wall_follower_32x32", "game", &run_wall_follower, 0},
+	{"bot_tremaux_32x32", "game", &run_tremaux, 0},
+	{"bot_solver_32x32", "game", &run_solver, 0},
+	{"render_maze_32x32", "render", &run_render, 0},
+	{"tree_encode_32x32", "maze", &run_tree_encode, 0},
+	{"tree_decode_32x32", "maze", &run_tree_decode, 0},
+	{"led_redraw_4", "redraw", &run_led_redraw, 4},
+	{"take_step", "step", &run_take_step, 0},
+	{"apply_input_64x64", "key", &run_apply_input, 0},
+	{"max7219_frame_8", "frame", &run_frame_encode, FB_DEVICES},
+	{"fb_full_refresh_4", "refresh", &run_full_refresh, 4},
+};
+
+#define NUM_CASES ((int) (sizeof(cases) / sizeof(cases[0])))
+
+
+/*---------------------------------------------------------------
+  Measurement
+ *---------------------------------------------------------------*/
+
+static uint64_t wall_ns() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t) t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+
+static uint64_t time_ops(const bench_case_t* c, size_t ops) {
+	uint64_t start = wall_ns();
+	sink += c->run(ops);
+	return wall_ns() - start;
+}
+
+
+static int compare_doubles(const void* a, const void* b) {
+	double x = *(const double*) a;
+	double y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+
+static bench_result_t results[MAX_RESULTS];
+static int num_results = 0;
+
+
+// Takes the next result slot, named and zeroed
+static bench_result_t* add_result(const char* unit, const char* fmt, ...) {
+	if (num_results == MAX_RESULTS) {
+		fprintf(stderr, "maze_bench: more than %d results\n", MAX_RESULTS);
+		exit(1);
+	}
+
+	bench_result_t* r = &results[num_results++];
+	memset(r, 0, sizeof(bench_result_t));
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(r->name, sizeof(r->name), fmt, args);
+	va_end(args);
+	r->unit = unit;
+	return r;
+}
+
+
+static void print_result(const bench_result_t* r) {
+	printf("%-26s %14.1f %14.0f %10.2f %12.0f\n", r->name,
+		r->ns_median, r->ns_median > 0 ? 1e9 / r->ns_median : 0.0, r->spi_bytes, r->wire_ns);
+}
+
+
+// Finds an op count that runs long enough, then times repetitions
+// of it. Bus totals are taken over the last repetition.
+static void measure(const bench_case_t* c, bool quick) {
+	bench_result_t* result = add_result(c->unit, "%s", c->name);
+	uint64_t min_ns = quick ? BENCH_MIN_NS_QUICK : BENCH_MIN_NS;
+	int reps = quick ? BENCH_REPS_QUICK : BENCH_REPS;
+	double per_op[BENCH_REPS];
+
+	if (c->devices > 0) {
+		chain.set_num_devices(c->devices);
+		fb_invalidate(&frame);
+	}
+
+	size_t ops = 1;
+	while (time_ops(c, ops) < min_ns && ops < ((size_t) 1 << 30)) {
+		ops *= 2;
+	}
+
+	for (int r = 0; r < reps; r++) {
+		host_reset_stats();
+		per_op[r] = (double) time_ops(c, ops) / ops;
+	}
+	qsort(per_op, reps, sizeof(double), compare_doubles);
+
+	host_stats_t stats = host_stats();
+	result->ops = ops;
+	result->ns_min = per_op[0];
+	result->ns_median = per_op[reps / 2];
+	result->spi_bytes = (double) stats.spi_bytes / ops;
+	result->spi_frames = (double) stats.spi_frames / ops;
+	result->wire_ns = (double) stats.wire_ns / ops;
+	print_result(result);
+}
+
+
+// Times one run of generating and solving a square maze in a layout,
+// per cell. Returns the path length, or -1 if it did not fit.
+static int measure_layout(int size, layout order) {
+	const char* name = order == LAYOUT_ROWS ? "rows" : "tiled";
+	size_t cells = (size_t) size * size;
+
+	maze_t* maze = new_maze_layout(size, size, order);
+	if (maze == NULL) {
+		printf("%s %dx%d: out of memory\n", name, size, size);
+		return -1;
+	}
+
+	srand(size);
+	uint64_t start = wall_ns();
+	int length = generate(maze) == 0 ? 0 : -1;
+	uint64_t generated = wall_ns();
+	if (length == 0) {
+		length = path_length(maze);
+	}
+	uint64_t solved = wall_ns();
+	free_maze(maze);
+
+	if (length < 0) {
+		printf("%s %dx%d: out of memory\n", name, size, size);
+		return -1;
+	}
+
+	bench_result_t* gen = add_result("cell", "generate_%s_%d", name, size);
+	gen->ops = cells;
+	gen->ns_min = gen->ns_median = (double) (generated - start) / cells;
+	print_result(gen);
+
+	bench_result_t* solve = add_result("cell", "solve_%s_%d", name, size);
+	solve->ops = cells;
+	solve->ns_min = solve->ns_median = (double) (solved - generated) / cells;
+	print_result(solve);
+	return length;
+}
+
+
+// Wall clock gaps between drawn moves: bot, keystroke, status rows,
+// terminal output and LEDs, everything play() does per key
+static uint64_t* gaps;
+static size_t num_gaps;
+static uint64_t last_move_ns;
+
+
+// Draws a move and lets one grayscale cycle pass before the next, so
+// the planes go out between keys as they would for a player. The
+// gap covers sending them.
+static void show_timed(state_t* state, char key, move_result result) {
+	show_move(state, key, result);
+	if (key != 0) {
+		host_advance_us(GRAY_CYCLE_US);
+	}
+	uint64_t now = wall_ns();
+	if (key != 0) {
+		gaps[num_gaps++] = now - last_move_ns;
+	}
+	last_move_ns = now;
+}
+
+
+static int compare_gaps(const void* a, const void* b) {
+	uint64_t x = *(const uint64_t*) a;
+	uint64_t y = *(const uint64_t*) b;
+	return (x > y) - (x < y);
+}
+
+
+// Plays seeded rounds of a bot through the display, as in a game.
+// The Timer inside run_bot reads the simulated clock, which mostly
+// counts the paced cycles, so the moves are timed by the wall clock
+// between draws. Every move must send each plane at least once.
+static bool measure_play(bot_kind kind, const char* name, bool quick) {
+	uint rounds = quick ? PLAY_ROUNDS_QUICK : PLAY_ROUNDS;
+	gaps = (uint64_t*) malloc(rounds * PLAY_MOVES * sizeof(uint64_t));
+	if (gaps == NULL) {
+		fprintf(stderr, "maze_bench: out of memory\n");
+		return false;
+	}
+	num_gaps = 0;
+
+	chain.set_num_devices(4);
+	fb_invalidate(&frame);
+	host_reset_stats();
+	bot_stats_t stats;
+	run_bot(kind, 0, rounds, PLAY_MOVES, &show_timed, &stats);
+	host_stats_t bus = host_stats();
+	show_stop();
+	term_end();
+	out_flush();
+
+	bench_result_t* r = add_result("move", "play_%s_8x8", name);
+	if (num_gaps > 0) {
+		qsort(gaps, num_gaps, sizeof(uint64_t), compare_gaps);
+		r->ops = num_gaps;
+		r->ns_min = gaps[0];
+		r->ns_median = gaps[num_gaps * 50 / 100];
+		r->ns_p90 = gaps[num_gaps * 90 / 100];
+		r->ns_p99 = gaps[num_gaps * 99 / 100];
+		r->spi_bytes = (double) bus.spi_bytes / num_gaps;
+		r->spi_frames = (double) bus.spi_frames / num_gaps;
+		r->wire_ns = (double) bus.wire_ns / num_gaps;
+	}
+	print_result(r);
+	printf("%-26s p90 %.0f, p99 %.0f ns/move, %.2f frames/move, %d/%d solved\n", "",
+		r->ns_p90, r->ns_p99, r->spi_frames, stats.completed, stats.rounds);
+
+	free(gaps);
+	if (num_gaps == 0 || bus.spi_frames < num_gaps * GRAY_PLANES) {
+		fprintf(stderr, "maze_bench: play_%s sent %u frames for %u moves\n",
+			name, (unsigned) bus.spi_frames, (unsigned) num_gaps);
+		return false;
+	}
+	return true;
+}
+
+
+// Row-major against tiled at every size. The large sizes take
+// seconds each, so every size is run once rather than repeated.
+// Both layouts must give the same maze, so the same path length.
+static bool measure_layouts(int max_size) {
+	for (int size = LAYOUT_MIN; size <= max_size; size *= 2) {
+		int rows = measure_layout(size, LAYOUT_ROWS);
+		int tiled = measure_layout(size, LAYOUT_TILED);
+		if (rows != tiled) {
+			fprintf(stderr, "maze_bench: %dx%d layouts disagree\n", size, size);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// One object per case, in a stable order so files diff cleanly
+static bool write_json(const char* path, bool quick) {
+	FILE* out = fopen(path, "w");
+	if (out == NULL) {
+		return false;
+	}
+
+	fprintf(out, "{\n");
+	fprintf(out, "  \"suite\": \"maze\",\n");
+	fprintf(out, "  \"version\": 1,\n");
+	fprintf(out, "  \"quick\": %s,\n", quick ? "true" : "false");
+	fprintf(out, "  \"compiler\": \"%s\",\n", __VERSION__);
+	fprintf(out, "  \"benchmarks\": [\n");
+	for (int i = 0; i < num_results; i++) {
+		const bench_result_t* r = &results[i];
+		fprintf(out, "    {\"name\": \"%s\", \"unit\": \"%s\", \"ops\": %lu, "
+			"\"ns_per_op\": %.1f, \"ns_per_op_min\": %.1f, \"ops_per_sec\": %.0f, "
+			"\"spi_bytes_per_op\": %.2f, \"spi_frames_per_op\": %.2f, \"wire_ns_per_op\": %.0f",
+			r->name, r->unit, (unsigned long) r->ops,
+			r->ns_median, r->ns_min, r->ns_median > 0 ? 1e9 / r->ns_median : 0.0,
+			r->spi_bytes, r->spi_frames, r->wire_ns);
+		if (r->ns_p99 > 0) {
+			fprintf(out, ", \"ns_per_op_p90\": %.0f, \"ns_per_op_p99\": %.0f", r->ns_p90, r->ns_p99);
+		}
+		fprintf(out, "}%s\n", i + 1 < num_results ? "," : "");
+	}
+	fprintf(out, "  ]\n");
+	fprintf(out, "}\n");
+
+	return fclose(out) == 0;
+}
+
+
+/*---------------------------------------------------------------
+  Main
+ *---------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+	bool quick = false;
+	const char* path = "bench.json";
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--quick") == 0) {
+			quick = true;
+		} else {
+			path = argv[i];
+		}
+	}
+
+	if (!fixtures_begin()) {
+		fprintf(stderr, "maze_bench: out of memory\n");
+		return 1;
+	}
+
+	printf("%-26s %14s %14s %10s %12s\n", "benchmark", "ns/op", "ops/s", "bytes/op", "wire ns/op");
+	for (int i = 0; i < NUM_CASES; i++) {
+		measure(&cases[i], quick);
+	}
+	bool played = measure_play(BOT_RANDOM, "random", quick) &&
+		measure_play(BOT_WALL_FOLLOWER, "wall_follower", quick) &&
+		measure_play(BOT_TREMAUX, "tremaux", quick) &&
+		measure_play(BOT_SOLVER, "solver", quick);
+	fixtures_end();
+	if (!played) {
+		return 1;
+	}
+
+	if (!measure_layouts(quick ? LAYOUT_MAX_QUICK : LAYOUT_MAX)) {
+		return 1;
+	}
+
+	if (!write_json(path, quick)) {
+		fprintf(stderr, "maze_bench: cannot write %s\n", path);
+		return 1;
+	}
+	printf("wrote %s\n", path);
+	return 0;
+}
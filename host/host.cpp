@@ -0,0 +1,627 @@
+/*
+ * host.cpp
+ *
+ */
+
+#include "host.h"
+
+/*---------------------------------------------------------------
+  Constants
+ *---------------------------------------------------------------*/
+
+// Most tickers and buttons alive at once
+#define HOST_TICKERS 16
+#define HOST_BUTTONS 8
+
+// Posted events waiting to run, and serial bytes waiting to be read
+#define HOST_EVENTS 32
+#define HOST_RX 256
+
+
+/*---------------------------------------------------------------
+  Simulation state
+ *---------------------------------------------------------------*/
+
+static uint64_t now_ns = 0;
+
+// Totals since the last reset, and bytes ever sent so a frame
+// still closes if the totals are reset in the middle of it
+static host_stats_t stats;
+static uint32_t total_bytes = 0;
+
+static bool recording = true;
+static host_event_t* logged = NULL;
+static size_t event_count = 0;
+static size_t event_capacity = 0;
+
+static Ticker* tickers[HOST_TICKERS];
+static InterruptIn* buttons[HOST_BUTTONS];
+
+// The SPI transfer in flight, if any
+static bool transfer_active = false;
+static uint64_t transfer_done_ns;
+static event_callback_t transfer_func;
+static int transfer_event;
+
+static Callback<void()> posted[HOST_EVENTS];
+static uint posted_head = 0;
+static uint posted_tail = 0;
+static bool dispatching = false;
+
+static char rx[HOST_RX];
+static uint rx_head = 0;
+static uint rx_tail = 0;
+static Callback<void()> rx_irq;
+static Callback<void()> tx_irq;
+static bool transmitting = false;
+static bool echo = true;
+
+
+// Appends to the event log, growing it as needed
+static void record(host_kind kind, PinName pin, uint8_t value, uint64_t time_ns) {
+	if (!recording) {
+		return;
+	}
+	if (event_count == event_capacity) {
+		size_t capacity = event_capacity ? event_capacity * 2 : 1024;
+		host_event_t* grown = (host_event_t*) realloc(logged, capacity * sizeof(host_event_t));
+		if (grown == NULL) {
+			return;
+		}
+		logged = grown;
+		event_capacity = capacity;
+	}
+
+	host_event_t* e = &logged[event_count++];
+	e->time_ns = time_ns;
+	e->kind = kind;
+	e->pin = pin;
+	e->value = value;
+}
+
+
+// Earliest ticker or transfer deadline. Returns the ticker, or NULL
+// for the transfer, and sets found to false if nothing is pending.
+static Ticker* next_due(uint64_t* due, bool* found) {
+	Ticker* next = NULL;
+	*due = 0;
+	*found = false;
+
+	if (transfer_active) {
+		*due = transfer_done_ns;
+		*found = true;
+	}
+	for (int i = 0; i < HOST_TICKERS; i++) {
+		Ticker* t = tickers[i];
+		if (t != NULL && t->_func && (!*found || t->_next_ns < *due)) {
+			*due = t->_next_ns;
+			*found = true;
+			next = t;
+		}
+	}
+	return next;
+}
+
+
+// Fires everything due up to target, in time order, then moves the
+// clock to target. Posted events only run if dispatch is set, since
+// a blocking SPI write lets interrupts in but not the event thread.
+static void run_until(uint64_t target, bool dispatch) {
+	while (true) {
+		uint64_t due;
+		bool found;
+		Ticker* t = next_due(&due, &found);
+		if (!found || due > target) {
+			break;
+		}
+
+		if (due > now_ns) {
+			now_ns = due;
+		}
+		if (t != NULL) {
+			t->_next_ns += t->_period_ns;
+			t->_func();
+		} else {
+			transfer_active = false;
+			transfer_func(transfer_event);
+		}
+
+		if (dispatch) {
+			mbed_event_queue()->dispatch();
+		}
+	}
+
+	if (target > now_ns) {
+		now_ns = target;
+	}
+	if (dispatch) {
+		mbed_event_queue()->dispatch();
+	}
+}
+
+
+// Logs bytes going out back to back from start, returning the time
+// the last one finishes
+static uint64_t clock_out(const char* tx_buffer, int tx_length, int length, char fill, int hz) {
+	uint64_t byte_ns = 8000000000ull / hz;
+	uint64_t time_ns = now_ns;
+
+	for (int i = 0; i < length; i++) {
+		uint8_t byte = i < tx_length ? tx_buffer[i] : fill;
+		record(HOST_SPI_BYTE, NC, byte, time_ns);
+		time_ns += byte_ns;
+	}
+
+	stats.spi_bytes += length;
+	stats.wire_ns += length * byte_ns;
+	total_bytes += length;
+	return time_ns;
+}
+
+
+/*---------------------------------------------------------------
+  Host functions
+ *---------------------------------------------------------------*/
+
+// The clock
+uint64_t host_now_ns() {
+	return now_ns;
+}
+
+
+// Lets time pass as a wait would
+void host_advance_us(uint32_t us) {
+	run_until(now_ns + (uint64_t) us * 1000, true);
+}
+
+
+// Forgets the totals and the log
+void host_reset_stats() {
+	memset(&stats, 0, sizeof(stats));
+	event_count = 0;
+}
+
+
+// The totals
+host_stats_t host_stats() {
+	return stats;
+}
+
+
+// Turns the log on or off
+void host_record(bool on) {
+	recording = on;
+}
+
+
+void host_echo(bool on) {
+	echo = on;
+}
+
+
+// Events logged
+size_t host_event_count() {
+	return event_count;
+}
+
+
+// One logged event, or NULL past the end
+const host_event_t* host_event_at(size_t i) {
+	return i < event_count ? &logged[i] : NULL;
+}
+
+
+// Fills the RX queue and interrupts
+void host_type(const char* text) {
+	for (; *text != '\0'; text++) {
+		if (rx_head - rx_tail < HOST_RX) {
+			rx[rx_head % HOST_RX] = *text;
+			rx_head++;
+		}
+	}
+	if (rx_irq) {
+		rx_irq();
+	}
+}
+
+
+// Fall, then rise
+void host_press(PinName pin) {
+	for (int i = 0; i < HOST_BUTTONS; i++) {
+		InterruptIn* b = buttons[i];
+		if (b != NULL && b->_pin == pin) {
+			if (b->_fall) {
+				b->_fall();
+			}
+			if (b->_rise) {
+				b->_rise();
+			}
+		}
+	}
+}
+
+
+/*---------------------------------------------------------------
+  Time
+ *---------------------------------------------------------------*/
+
+uint32_t us_ticker_read() {
+	return (uint32_t) (now_ns / 1000);
+}
+
+
+void wait(float s) {
+	run_until(now_ns + (uint64_t) (s * 1e9f), true);
+}
+
+
+void wait_ms(int ms) {
+	run_until(now_ns + (uint64_t) ms * 1000000, true);
+}
+
+
+void wait_us(int us) {
+	run_until(now_ns + (uint64_t) us * 1000, true);
+}
+
+
+// Wakes for the next deadline, if there is one
+void sleep() {
+	uint64_t due;
+	bool found;
+	next_due(&due, &found);
+	run_until(found ? due : now_ns, true);
+}
+
+
+void core_util_critical_section_enter() {
+}
+
+
+void core_util_critical_section_exit() {
+}
+
+
+bool core_util_is_isr_active() {
+	return false;
+}
+
+
+Timer::Timer() : _running(false), _start_ns(0), _total_ns(0) {
+}
+
+
+void Timer::start() {
+	if (!_running) {
+		_running = true;
+		_start_ns = now_ns;
+	}
+}
+
+
+void Timer::stop() {
+	if (_running) {
+		_running = false;
+		_total_ns += now_ns - _start_ns;
+	}
+}
+
+
+void Timer::reset() {
+	_start_ns = now_ns;
+	_total_ns = 0;
+}
+
+
+float Timer::read() {
+	return read_us() / 1e6f;
+}
+
+
+int Timer::read_ms() {
+	return read_us() / 1000;
+}
+
+
+int Timer::read_us() {
+	uint64_t total = _total_ns + (_running ? now_ns - _start_ns : 0);
+	return (int) (total / 1000);
+}
+
+
+// Registers so run_until can find it
+Ticker::Ticker() : _period_ns(0), _next_ns(0) {
+	for (int i = 0; i < HOST_TICKERS; i++) {
+		if (tickers[i] == NULL) {
+			tickers[i] = this;
+			return;
+		}
+	}
+	fprintf(stderr, "host: more than %d tickers\n", HOST_TICKERS);
+	abort();
+}
+
+
+Ticker::~Ticker() {
+	for (int i = 0; i < HOST_TICKERS; i++) {
+		if (tickers[i] == this) {
+			tickers[i] = NULL;
+		}
+	}
+}
+
+
+void Ticker::attach(Callback<void()> func, float s) {
+	attach_us(func, (uint32_t) (s * 1e6f));
+}
+
+
+// A zero period would never let time pass, so it is at least 1 us
+void Ticker::attach_us(Callback<void()> func, uint32_t us) {
+	_func = func;
+	_period_ns = (uint64_t) (us ? us : 1) * 1000;
+	_next_ns = now_ns + _period_ns;
+}
+
+
+void Ticker::detach() {
+	_func = Callback<void()>();
+}
+
+
+/*---------------------------------------------------------------
+  Event queue
+ *---------------------------------------------------------------*/
+
+namespace events {
+
+// Returns 0 if the queue is full, like a failed allocation
+int EventQueue::post(Callback<void()> func) {
+	if (posted_head - posted_tail == HOST_EVENTS) {
+		return 0;
+	}
+	posted[posted_head % HOST_EVENTS] = func;
+	posted_head++;
+	return posted_head;
+}
+
+
+// Runs everything posted, including what that posts in turn
+void EventQueue::dispatch() {
+	if (dispatching) {
+		return;
+	}
+	dispatching = true;
+	while (posted_tail != posted_head) {
+		Callback<void()> func = posted[posted_tail % HOST_EVENTS];
+		posted_tail++;
+		func();
+	}
+	dispatching = false;
+}
+
+}
+
+
+EventQueue* mbed_event_queue() {
+	static EventQueue queue;
+	return &queue;
+}
+
+
+/*---------------------------------------------------------------
+  Pins
+ *---------------------------------------------------------------*/
+
+DigitalOut::DigitalOut(PinName pin, int value) : _pin(pin), _value(value), _bytes_at_fall(0) {
+}
+
+
+// Logs edges and closes frames
+void DigitalOut::write(int value) {
+	value = value ? 1 : 0;
+	if (value == _value) {
+		return;
+	}
+
+	_value = value;
+	stats.pin_edges++;
+	record(HOST_PIN_EDGE, _pin, value, now_ns);
+
+	if (value == 0) {
+		_bytes_at_fall = total_bytes;
+	} else if (total_bytes != _bytes_at_fall) {
+		stats.spi_frames++;
+		stats.last_frame_bytes = total_bytes - _bytes_at_fall;
+	}
+}
+
+
+int DigitalOut::read() {
+	return _value;
+}
+
+
+DigitalOut& DigitalOut::operator=(int value) {
+	write(value);
+	return *this;
+}
+
+
+DigitalOut::operator int() {
+	return _value;
+}
+
+
+InterruptIn::InterruptIn(PinName pin) : _pin(pin) {
+	for (int i = 0; i < HOST_BUTTONS; i++) {
+		if (buttons[i] == NULL) {
+			buttons[i] = this;
+			return;
+		}
+	}
+	fprintf(stderr, "host: more than %d buttons\n", HOST_BUTTONS);
+	abort();
+}
+
+
+InterruptIn::~InterruptIn() {
+	for (int i = 0; i < HOST_BUTTONS; i++) {
+		if (buttons[i] == this) {
+			buttons[i] = NULL;
+		}
+	}
+}
+
+
+void InterruptIn::rise(Callback<void()> func) {
+	_rise = func;
+}
+
+
+void InterruptIn::fall(Callback<void()> func) {
+	_fall = func;
+}
+
+
+/*---------------------------------------------------------------
+  SPI
+ *---------------------------------------------------------------*/
+
+SPI::SPI(PinName mosi, PinName miso, PinName sclk, PinName ssel) : _hz(1000000), _fill(0xFF) {
+}
+
+
+void SPI::format(int bits, int mode) {
+}
+
+
+void SPI::frequency(int hz) {
+	_hz = hz > 0 ? hz : 1000000;
+}
+
+
+// One byte; nothing drives MISO, so it reads 0
+int SPI::write(int value) {
+	char byte = value;
+	write(&byte, 1, NULL, 0);
+	return 0;
+}
+
+
+// Blocks for the wire time, letting interrupts in meanwhile
+int SPI::write(const char* tx_buffer, int tx_length, char* rx_buffer, int rx_length) {
+	int length = tx_length > rx_length ? tx_length : rx_length;
+	if (rx_buffer != NULL) {
+		memset(rx_buffer, 0, rx_length);
+	}
+	run_until(clock_out(tx_buffer, tx_length, length, _fill, _hz), false);
+	return length;
+}
+
+
+void SPI::set_default_write_value(char data) {
+	_fill = data;
+}
+
+
+void SPI::lock() {
+}
+
+
+void SPI::unlock() {
+}
+
+
+// Logs the bytes now and calls back once they are all out
+int SPI::start_transfer(const char* tx_buffer, int tx_length, char* rx_buffer, int rx_length,
+	const event_callback_t& func, int event)
+{
+	if (transfer_active) {
+		return -1;
+	}
+
+	int length = tx_length > rx_length ? tx_length : rx_length;
+	if (rx_buffer != NULL) {
+		memset(rx_buffer, 0, rx_length);
+	}
+	transfer_done_ns = clock_out(tx_buffer, tx_length, length, _fill, _hz);
+	transfer_func = func;
+	transfer_event = event & SPI_EVENT_COMPLETE;
+	transfer_active = true;
+	return 0;
+}
+
+
+void SPI::abort_transfer() {
+	transfer_active = false;
+}
+
+
+/*---------------------------------------------------------------
+  Serial
+ *---------------------------------------------------------------*/
+
+RawSerial::RawSerial(PinName tx, PinName rx, int baud) {
+}
+
+
+void RawSerial::baud(int baudrate) {
+}
+
+
+// Next typed byte, or -1 if there is none
+int RawSerial::getc() {
+	if (rx_tail == rx_head) {
+		return -1;
+	}
+	return (uint8_t) rx[rx_tail++ % HOST_RX];
+}
+
+
+int RawSerial::putc(int c) {
+	return echo ? fputc(c, stdout) : c;
+}
+
+
+int RawSerial::puts(const char* str) {
+	return echo ? fputs(str, stdout) : 0;
+}
+
+
+int RawSerial::printf(const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	int len = echo ? vprintf(format, args) : vsnprintf(NULL, 0, format, args);
+	va_end(args);
+	return len;
+}
+
+
+bool RawSerial::readable() {
+	return rx_tail != rx_head;
+}
+
+
+bool RawSerial::writeable() {
+	return true;
+}
+
+
+// The transmitter is always empty, so a TX handler runs at once
+// and keeps running until it detaches itself
+void RawSerial::attach(Callback<void()> func, IrqType type) {
+	if (type == RxIrq) {
+		rx_irq = func;
+		return;
+	}
+
+	tx_irq = func;
+	if (!transmitting) {
+		transmitting = true;
+		while (tx_irq) {
+			tx_irq();
+		}
+		transmitting = false;
+	}
+}
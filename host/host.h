@@ -0,0 +1,111 @@
+/*
+ * host.h
+ *
+ * Simulation controls and accounting for the host build. Every SPI
+ * byte and pin edge is recorded with its simulated time, so tests
+ * and benchmarks can check bytes per frame, frames per move and how
+ * long the traffic keeps the wire busy.
+ *
+ * A byte takes 8 clocks at the SPI frequency (1 MHz unless set), so
+ * one Max7219 register write to a single device, 2 bytes, is 16 us.
+ */
+
+#ifndef HOST_H_
+#define HOST_H_
+
+#include "mbed.h"
+
+
+/*---------------------------------------------------------------
+  Host types
+ *---------------------------------------------------------------*/
+
+/**
+ * Kind of a recorded event.
+ */
+enum host_kind {HOST_SPI_BYTE, HOST_PIN_EDGE};
+
+/**
+ * A recorded event: a byte starting out on the wire, or a pin
+ * changing level.
+ */
+typedef struct {
+	uint64_t time_ns;
+	host_kind kind;
+	PinName pin;
+	uint8_t value;
+} host_event_t;
+
+/**
+ * Running totals since the last host_reset_stats.
+ */
+typedef struct {
+	uint32_t spi_bytes;
+	uint32_t spi_frames;
+	uint32_t pin_edges;
+	uint32_t last_frame_bytes;
+	uint64_t wire_ns;
+} host_stats_t;
+
+
+
+/*---------------------------------------------------------------
+  Host functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Simulated nanoseconds since start.
+ */
+uint64_t host_now_ns();
+
+/**
+ * Moves the clock forward, firing tickers and SPI completions as
+ * they fall due and then running posted events.
+ */
+void host_advance_us(uint32_t us);
+
+/**
+ * Clears the totals and the event log. The clock keeps running.
+ */
+void host_reset_stats();
+
+/**
+ * Totals since the last reset.
+ */
+host_stats_t host_stats();
+
+/**
+ * Turns the event log on or off; totals are always kept. Long
+ * benchmarks turn it off so it does not grow without bound.
+ */
+void host_record(bool on);
+
+/**
+ * Turns copying serial output to stdout on or off. The port takes
+ * every byte either way; benchmarks turn it off to time the output
+ * path without the terminal.
+ */
+void host_echo(bool on);
+
+/**
+ * Number of events logged since the last reset.
+ */
+size_t host_event_count();
+
+/**
+ * The i-th logged event, oldest first.
+ */
+const host_event_t* host_event_at(size_t i);
+
+/**
+ * Queues text on the serial RX line and raises the RX interrupt.
+ */
+void host_type(const char* text);
+
+/**
+ * Presses and releases the button on a pin, raising its fall and
+ * then rise interrupts.
+ */
+void host_press(PinName pin);
+
+#endif /* HOST_H_ */
@@ -0,0 +1,50 @@
+/*
+ * main.cpp
+ *
+ * Host test runner: the board's tests plus the bus accounting
+ * tests, against the simulated devices in host.cpp.
+ */
+
+#include "main.h"
+#include "test_host.h"
+
+/*---------------------------------------------------------------
+  Device configuration
+ *---------------------------------------------------------------*/
+
+// Same wiring as the board
+DigitalOut led1(LED1);
+RawSerial pc(USBTX, USBRX);
+Max7219 mat(PTD2, PTD3, PTD1, PTD0);
+uint8_t MATRIX = 1;
+framebuffer_t fb;
+
+
+/*---------------------------------------------------------------
+  Main
+ *---------------------------------------------------------------*/
+
+int main() {
+	max7219_configuration_t cfg = {
+		.device_number = MATRIX,
+		.decode_mode = 0,
+		.intensity = Max7219::MAX7219_INTENSITY_8,
+		.scan_limit = Max7219::MAX7219_SCAN_8
+	};
+
+	init_input(&pc);
+	init_output(&pc);
+
+	mat.set_num_devices(1);
+	mat.init_display(cfg);
+	mat.enable_display();
+	fb_init(&fb, &mat, 1);
+	fb_flush(&fb);
+	init_anim(&fb);
+	show_init(&fb, 1, 1);
+
+	int failed = run_tests();
+	failed += run_host_tests();
+	out_flush();
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,316 @@
+/*
+ * mbed.h
+ *
+ * Host stand-in for the parts of the mbed OS API the game uses, so
+ * the game, its tests and the Max7219 driver build and run on Linux.
+ * Put this directory first on the include path instead of mbed-os.
+ *
+ * Time is simulated, see host.h: it only moves when the code waits
+ * or sleeps, or while a blocking SPI write is on the wire. Tickers
+ * fire as time passes, like interrupts. Work posted to the event
+ * queue runs when the code next waits or sleeps. A loop spinning on
+ * a flag without waiting never sees time pass.
+ */
+
+#ifndef HOST_MBED_H_
+#define HOST_MBED_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <sys/types.h>
+
+#include <functional>
+
+
+/*---------------------------------------------------------------
+  Target
+ *---------------------------------------------------------------*/
+
+#define DEVICE_SPI 1
+#define DEVICE_SPI_ASYNCH 1
+#define DEVICE_INTERRUPTIN 1
+#define DEVICE_SERIAL 1
+
+#define SPI_EVENT_ERROR (1 << 1)
+#define SPI_EVENT_COMPLETE (1 << 2)
+#define SPI_EVENT_RX_OVERFLOW (1 << 3)
+#define SPI_EVENT_ALL (SPI_EVENT_ERROR | SPI_EVENT_COMPLETE | SPI_EVENT_RX_OVERFLOW)
+
+/**
+ * Pins of the K64F board used by the game.
+ */
+typedef enum {
+	PTD0, PTD1, PTD2, PTD3,
+	LED1, LED2, LED3,
+	SW2, SW3,
+	USBTX, USBRX,
+	NC = -1
+} PinName;
+
+
+/*---------------------------------------------------------------
+  Callbacks
+ *---------------------------------------------------------------*/
+
+template <typename F>
+class Callback;
+
+/**
+ * A function or a method bound to an object, like mbed's Callback.
+ */
+template <typename R, typename... A>
+class Callback<R(A...)> {
+public:
+	Callback() {}
+	Callback(R (*func)(A...)) {
+		if (func != NULL) {
+			_func = func;
+		}
+	}
+	template <typename T, typename U>
+	Callback(U* obj, R (T::*method)(A...)) {
+		_func = [obj, method](A... args) { return (obj->*method)(args...); };
+	}
+
+	R call(A... args) const { return _func(args...); }
+	R operator()(A... args) const { return _func(args...); }
+	operator bool() const { return (bool) _func; }
+
+private:
+	std::function<R(A...)> _func;
+};
+
+template <typename R, typename... A>
+Callback<R(A...)> callback(R (*func)(A...)) {
+	return Callback<R(A...)>(func);
+}
+
+template <typename T, typename U, typename R, typename... A>
+Callback<R(A...)> callback(U* obj, R (T::*method)(A...)) {
+	return Callback<R(A...)>(obj, method);
+}
+
+typedef Callback<void(int)> event_callback_t;
+
+
+/*---------------------------------------------------------------
+  Time
+ *---------------------------------------------------------------*/
+
+/**
+ * Simulated microseconds since start.
+ */
+uint32_t us_ticker_read();
+
+void wait(float s);
+void wait_ms(int ms);
+void wait_us(int us);
+
+/**
+ * Runs whatever is due next: jumps to the earliest ticker or SPI
+ * completion and fires it. Returns at once if nothing is pending.
+ */
+void sleep();
+
+/**
+ * Interrupts are never nested here, so these do nothing.
+ */
+void core_util_critical_section_enter();
+void core_util_critical_section_exit();
+
+/**
+ * Always false; tickers and completions are not tracked as running
+ * in interrupt context.
+ */
+bool core_util_is_isr_active();
+
+/**
+ * Stopwatch on the simulated clock.
+ */
+class Timer {
+public:
+	Timer();
+	void start();
+	void stop();
+	void reset();
+	float read();
+	int read_ms();
+	int read_us();
+
+private:
+	bool _running;
+	uint64_t _start_ns;
+	uint64_t _total_ns;
+};
+
+/**
+ * Periodic callback on the simulated clock.
+ */
+class Ticker {
+public:
+	Ticker();
+	~Ticker();
+	void attach(Callback<void()> func, float s);
+	void attach_us(Callback<void()> func, uint32_t us);
+	void detach();
+
+	Callback<void()> _func;
+	uint64_t _period_ns;
+	uint64_t _next_ns;
+};
+
+
+/*---------------------------------------------------------------
+  Event queue
+ *---------------------------------------------------------------*/
+
+namespace events {
+
+/**
+ * Deferred calls, run when the code next waits or sleeps.
+ */
+class EventQueue {
+public:
+	template <typename F>
+	int call(F func) {
+		return post(Callback<void()>(func));
+	}
+	template <typename T, typename U>
+	int call(U* obj, void (T::*method)()) {
+		return post(Callback<void()>(obj, method));
+	}
+
+	int post(Callback<void()> func);
+	void dispatch();
+};
+
+}
+
+using events::EventQueue;
+
+/**
+ * The shared queue.
+ */
+EventQueue* mbed_event_queue();
+
+
+/*---------------------------------------------------------------
+  Pins
+ *---------------------------------------------------------------*/
+
+/**
+ * Output pin. Every level change is logged, and a rising edge after
+ * SPI traffic since the falling one closes a frame.
+ */
+class DigitalOut {
+public:
+	DigitalOut(PinName pin, int value = 0);
+	void write(int value);
+	int read();
+	DigitalOut& operator=(int value);
+	operator int();
+
+private:
+	PinName _pin;
+	int _value;
+	uint32_t _bytes_at_fall;
+};
+
+/**
+ * Button input. host_press drives the edges.
+ */
+class InterruptIn {
+public:
+	InterruptIn(PinName pin);
+	~InterruptIn();
+	void rise(Callback<void()> func);
+	void fall(Callback<void()> func);
+
+	PinName _pin;
+	Callback<void()> _rise;
+	Callback<void()> _fall;
+};
+
+
+/*---------------------------------------------------------------
+  SPI
+ *---------------------------------------------------------------*/
+
+/**
+ * SPI master. Bytes are logged as they would go out on the wire at
+ * the set frequency. Nothing drives MISO, so reads return 0.
+ */
+class SPI {
+public:
+	SPI(PinName mosi, PinName miso, PinName sclk, PinName ssel = NC);
+	void format(int bits, int mode = 0);
+	void frequency(int hz = 1000000);
+	int write(int value);
+	int write(const char* tx_buffer, int tx_length, char* rx_buffer, int rx_length);
+	void set_default_write_value(char data);
+	void lock();
+	void unlock();
+
+	/**
+	 * Starts a transfer that finishes, and calls back, once its
+	 * wire time has passed. Returns -1 if one is already running.
+	 */
+	template <typename T>
+	int transfer(const T* tx_buffer, int tx_length, T* rx_buffer, int rx_length,
+		const event_callback_t& func, int event = SPI_EVENT_COMPLETE)
+	{
+		return start_transfer((const char*) tx_buffer, tx_length * sizeof(T),
+			(char*) rx_buffer, rx_length * sizeof(T), func, event);
+	}
+
+	/**
+	 * Drops the running transfer without calling back. Bytes already
+	 * logged stay logged.
+	 */
+	void abort_transfer();
+
+private:
+	int start_transfer(const char* tx_buffer, int tx_length, char* rx_buffer, int rx_length,
+		const event_callback_t& func, int event);
+
+	int _hz;
+	char _fill;
+};
+
+
+/*---------------------------------------------------------------
+  Serial
+ *---------------------------------------------------------------*/
+
+class SerialBase {
+public:
+	enum IrqType {RxIrq = 0, TxIrq};
+};
+
+/**
+ * Serial port on stdout, always writeable. Input comes from
+ * host_type.
+ */
+class RawSerial : public SerialBase {
+public:
+	RawSerial(PinName tx, PinName rx, int baud = 9600);
+	void baud(int baudrate);
+	int getc();
+	int putc(int c);
+	int puts(const char* str);
+	int printf(const char* format, ...);
+	bool readable();
+	bool writeable();
+	void attach(Callback<void()> func, IrqType type = RxIrq);
+};
+
+class Serial : public RawSerial {
+public:
+	Serial(PinName tx, PinName rx, int baud = 9600) : RawSerial(tx, rx, baud) {}
+};
+
+#endif /* HOST_MBED_H_ */
@@ -0,0 +1,386 @@
+/*
+ * server.cpp
+ *
+ * Host maze server: many games at once from one Linux process.
+ * Sessions connect over a Unix domain socket and speak the binary
+ * protocol of protocol.h. Each has its own game and seed, answered
+ * through the same session code as the board's binary mode, so every
+ * move goes through apply_input().
+ *
+ *     maze_server SOCKET
+ *     maze_server --bench [SESSIONS] [MOVES]
+ *
+ * The bench mode serves from a child process, connects SESSIONS
+ * clients to it, plays MOVES random keys on each in turn and reports
+ * the round trip latency of a move.
+ */
+
+#include "mbed.h"
+#include "session.h"
+#include "maze_client.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------
+  Constants
+ *---------------------------------------------------------------*/
+
+// Events taken from epoll at once, and bytes read from a session
+#define EVENTS 256
+#define READ_SIZE 512
+
+// Pending connections the listening socket holds
+#define BACKLOG 1024
+
+// epoll tag of the listening socket; sessions are tagged by slot
+#define LISTENER UINT64_MAX
+
+// Bench defaults
+#define BENCH_SESSIONS 2000
+#define BENCH_MOVES 50
+
+
+
+/*---------------------------------------------------------------
+  Session table
+ *---------------------------------------------------------------*/
+
+// Sessions are dense: slots 0 to count - 1 are in use, and closing
+// one moves the last session into its slot. Each slot's game and
+// seed, decoder and socket sit in parallel arrays.
+static session_t* sessions;
+static proto_parser_t* parsers;
+static int* fds;
+static int count = 0;
+static int capacity = 0;
+
+static int epoll_fd = -1;
+
+
+// Doubles the table. Arrays that did grow are kept if another fails,
+// the capacity only changes once all three have.
+static bool grow() {
+	int more = capacity ? capacity * 2 : 64;
+	session_t* s = (session_t*) realloc(sessions, more * sizeof(session_t));
+	if (s != NULL) {
+		sessions = s;
+	}
+	proto_parser_t* p = (proto_parser_t*) realloc(parsers, more * sizeof(proto_parser_t));
+	if (p != NULL) {
+		parsers = p;
+	}
+	int* f = (int*) realloc(fds, more * sizeof(int));
+	if (f != NULL) {
+		fds = f;
+	}
+	if (s == NULL || p == NULL || f == NULL) {
+		return false;
+	}
+	capacity = more;
+	return true;
+}
+
+
+// Points the socket's epoll events at its slot
+static int watch(int op, int slot) {
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.u64 = slot;
+	return epoll_ctl(epoll_fd, op, fds[slot], &event);
+}
+
+
+// Takes a new connection into the next slot, with no game yet
+static bool add_session(int fd) {
+	if (count == capacity && !grow()) {
+		return false;
+	}
+	fds[count] = fd;
+	if (watch(EPOLL_CTL_ADD, count) != 0) {
+		return false;
+	}
+	session_init(&sessions[count]);
+	proto_reset(&parsers[count]);
+	count++;
+	return true;
+}
+
+
+// Closes a session and fills its slot with the last one
+static void drop_session(int slot) {
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fds[slot], NULL);
+	close(fds[slot]);
+	session_free(&sessions[slot]);
+
+	int last = --count;
+	if (slot != last) {
+		sessions[slot] = sessions[last];
+		parsers[slot] = parsers[last];
+		fds[slot] = fds[last];
+		watch(EPOLL_CTL_MOD, slot);
+	}
+}
+
+
+
+/*---------------------------------------------------------------
+  Event loop
+ *---------------------------------------------------------------*/
+
+// Answers every complete frame in what the session sent, in one
+// write. A session that hung up, or does not read its answers, is
+// closed.
+static void serve_session(int slot) {
+	uint8_t in[READ_SIZE];
+	ssize_t n = read(fds[slot], in, sizeof(in));
+	if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+		return;
+	}
+	if (n <= 0) {
+		drop_session(slot);
+		return;
+	}
+
+	// The shortest request is 4 bytes, and every answer is a status
+	uint8_t out[READ_SIZE / 4 * (PROTO_STATUS_SIZE + 3) + PROTO_MAX_FRAME];
+	size_t used = 0;
+	for (ssize_t i = 0; i < n; i++) {
+		proto_parser_t* parser = &parsers[slot];
+		if (proto_feed(parser, in[i]) == 1) {
+			used += session_answer(&sessions[slot], parser->payload, parser->len, out + used);
+		}
+	}
+	if (used > 0 && send(fds[slot], out, used, MSG_NOSIGNAL) != (ssize_t) used) {
+		drop_session(slot);
+	}
+}
+
+
+// Takes every pending connection
+static void accept_sessions(int listener) {
+	while (true) {
+		int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK);
+		if (fd < 0) {
+			return;
+		}
+		if (!add_session(fd)) {
+			close(fd);
+		}
+	}
+}
+
+
+// Serves the listening socket until an error. Events are level
+// triggered, so one that names a slot already closed or refilled
+// this round is just a read with nothing to read, and the moved
+// session is reported again on the next wait.
+static int serve(int listener) {
+	epoll_fd = epoll_create1(0);
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.u64 = LISTENER;
+	if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listener, &event) != 0) {
+		perror("maze_server: epoll");
+		return 1;
+	}
+
+	struct epoll_event events[EVENTS];
+	while (true) {
+		int ready = epoll_wait(epoll_fd, events, EVENTS, -1);
+		if (ready < 0 && errno != EINTR) {
+			perror("maze_server: epoll_wait");
+			return 1;
+		}
+		for (int i = 0; i < ready; i++) {
+			uint64_t tag = events[i].data.u64;
+			if (tag == LISTENER) {
+				accept_sessions(listener);
+			} else if (tag < (uint64_t) count) {
+				serve_session((int) tag);
+			}
+		}
+	}
+}
+
+
+// Non-blocking socket listening at path, or -1
+static int listen_on(const char* path) {
+	struct sockaddr_un addr;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	unlink(path);
+	if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, BACKLOG) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+
+// Every session needs a descriptor, so allow as many as we may
+static void raise_fd_limit() {
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+}
+
+
+
+/*---------------------------------------------------------------
+  Load test
+ *---------------------------------------------------------------*/
+
+static uint64_t wall_ns() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t) t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+
+static int compare_ns(const void* a, const void* b) {
+	uint64_t x = *(const uint64_t*) a;
+	uint64_t y = *(const uint64_t*) b;
+	return (x > y) - (x < y);
+}
+
+
+// Connects the clients to a forked server, starts a maze on each
+// and times every move's round trip. Returns the number of requests
+// that failed, counting every session left unconnected as one.
+static int bench(int num_sessions, int moves) {
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/maze_server_%d.sock", (int) getpid());
+	int listener = listen_on(path);
+	if (listener < 0) {
+		perror("maze_server: listen");
+		return 1;
+	}
+
+	pid_t server = fork();
+	if (server == 0) {
+		_exit(serve(listener));
+	}
+	close(listener);
+	if (server < 0) {
+		perror("maze_server: fork");
+		unlink(path);
+		return 1;
+	}
+
+	maze_client_t* clients = (maze_client_t*) calloc(num_sessions, sizeof(maze_client_t));
+	uint64_t* gaps = (uint64_t*) malloc((size_t) num_sessions * moves * sizeof(uint64_t));
+	int failed = 0;
+	int open = 0;
+	size_t timed = 0;
+
+	if (clients == NULL || gaps == NULL) {
+		fprintf(stderr, "maze_server: out of memory\n");
+		failed = num_sessions;
+	}
+
+	// Every session gets its own seed
+	proto_status_t status;
+	for (; failed == 0 && open < num_sessions; open++) {
+		if (client_connect(&clients[open], path) != 0) {
+			perror("maze_server: connect");
+			failed = num_sessions - open;
+			break;
+		}
+		if (client_start(&clients[open], open + 1, &status) != 0 || status.flags != 0) {
+			failed++;
+		}
+	}
+
+	srand(1);
+	for (int m = 0; failed == 0 && m < moves; m++) {
+		for (int s = 0; s < num_sessions; s++) {
+			char key = "wasd"[rand() % 4];
+			uint64_t start = wall_ns();
+			int sent = client_move(&clients[s], key, &status);
+			gaps[timed++] = wall_ns() - start;
+			if (sent != 0 || (status.flags & (PROTO_ERROR | PROTO_INVALID))) {
+				failed++;
+			}
+		}
+	}
+
+	if (timed > 0) {
+		qsort(gaps, timed, sizeof(uint64_t), &compare_ns);
+		uint64_t total = 0;
+		for (size_t i = 0; i < timed; i++) {
+			total += gaps[i];
+		}
+		printf("%d sessions, %zu moves: per move mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+			num_sessions, timed, total / 1e3 / timed, gaps[timed / 2] / 1e3,
+			gaps[timed * 99 / 100] / 1e3, gaps[timed - 1] / 1e3);
+	}
+
+	for (int s = 0; s < open; s++) {
+		client_close(&clients[s]);
+	}
+	kill(server, SIGTERM);
+	waitpid(server, NULL, 0);
+	unlink(path);
+	free(clients);
+	free(gaps);
+
+	if (failed) {
+		fprintf(stderr, "maze_server: %d requests failed\n", failed);
+	}
+	return failed;
+}
+
+
+
+/*---------------------------------------------------------------
+  Main
+ *---------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+	raise_fd_limit();
+
+	if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+		int num_sessions = argc > 2 ? atoi(argv[2]) : BENCH_SESSIONS;
+		int moves = argc > 3 ? atoi(argv[3]) : BENCH_MOVES;
+		if (num_sessions <= 0 || moves <= 0) {
+			fprintf(stderr, "usage: %s --bench [SESSIONS] [MOVES]\n", argv[0]);
+			return 2;
+		}
+		return bench(num_sessions, moves) ? 1 : 0;
+	}
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s SOCKET\n       %s --bench [SESSIONS] [MOVES]\n", argv[0], argv[0]);
+		return 2;
+	}
+	int listener = listen_on(argv[1]);
+	if (listener < 0) {
+		perror(argv[1]);
+		return 1;
+	}
+	printf("serving mazes on %s\n", argv[1]);
+	fflush(stdout);
+	return serve(listener);
+}
@@ -0,0 +1,454 @@
+/*
+ * test_host.cpp
+ *
+ */
+
+#include "test_host.h"
+
+/* Test helpers */
+
+// Chip select of the LED matrix
+#define CS_PIN PTD0
+
+// Wire time of one byte at the default 1 MHz
+#define BYTE_NS 8000
+
+static point_t shown_at;
+
+// Lights only the player
+static int show_at(void* ctx, int x, int y) {
+	return x == shown_at.x && y == shown_at.y;
+}
+
+
+/* Test cases */
+
+// Tests that one register write is one CS frame holding one
+// register and value per device
+bool test_host_frame() {
+	out_printf("Starting host frame test\n");
+	uint8_t data[1] = {0x81};
+
+	mat.invalidate_cache();
+	host_reset_stats();
+	mat.write_digit_all(Max7219::MAX7219_DIGIT_0, data, 1);
+	host_stats_t stats = host_stats();
+
+	bool ok = stats.spi_frames == 1 && stats.spi_bytes == 2 &&
+		stats.last_frame_bytes == 2 && stats.wire_ns == 2 * BYTE_NS &&
+		stats.pin_edges == 2 && host_event_count() == 4;
+
+	// CS low, register, value, CS high once both bytes are out
+	const host_event_t* fall = host_event_at(0);
+	const host_event_t* reg = host_event_at(1);
+	const host_event_t* value = host_event_at(2);
+	const host_event_t* rise = host_event_at(3);
+	ok = ok && fall->kind == HOST_PIN_EDGE && fall->pin == CS_PIN && fall->value == 0 &&
+		reg->kind == HOST_SPI_BYTE && reg->value == Max7219::MAX7219_DIGIT_0 &&
+		value->kind == HOST_SPI_BYTE && value->value == 0x81 &&
+		rise->kind == HOST_PIN_EDGE && rise->pin == CS_PIN && rise->value == 1 &&
+		rise->time_ns - fall->time_ns == 2 * BYTE_NS;
+
+	// The same value again stays off the bus
+	mat.write_digit_all(Max7219::MAX7219_DIGIT_0, data, 1);
+	ok = ok && host_stats().spi_frames == 1;
+
+	data[0] = 0;
+	mat.write_digit_all(Max7219::MAX7219_DIGIT_0, data, 1);
+	fb_invalidate(&fb);
+
+	if (!ok) {
+		out_printf("Failed host frame test\n");
+		return false;
+	}
+	out_printf("Passed host frame test\n");
+	return true;
+}
+
+
+// Tests that a move sends one frame per matrix column it touches:
+// one going north or south, two going east or west
+bool test_host_move() {
+	out_printf("Starting host move test\n");
+	framebuffer_t local;
+	viewport_t view;
+
+	srand(3);
+	state_t* state = init_state();
+	bool ok = state != NULL;
+	if (ok) {
+		shown_at = state->curr_pos;
+		fb_init(&local, &mat, MATRIX);
+		view_init(&view, &local, 1, 1, state->maze->width, state->maze->height, &show_at, NULL);
+		view_follow(&view, shown_at);
+		view_redraw(&view);
+		fb_flush(&local);
+		fb_wait(&local);
+	}
+
+	int moves = 0;
+	uint32_t frames = 0;
+	uint64_t wire_ns = 0;
+	for (int i = 0; ok && i < 200; i++) {
+		point_t before = state->curr_pos;
+		if (apply_input("wasd"[rand() % 4], state) < MOVE_OK) {
+			continue;
+		}
+
+		host_reset_stats();
+		shown_at = state->curr_pos;
+		view_update(&view, before.x, before.y);
+		view_update(&view, shown_at.x, shown_at.y);
+		view_follow(&view, shown_at);
+		fb_flush(&local);
+		fb_wait(&local);
+
+		host_stats_t stats = host_stats();
+		uint32_t expected = before.x == shown_at.x ? 1 : 2;
+		ok = stats.spi_frames == expected && stats.spi_bytes == expected * 2 &&
+			stats.wire_ns == expected * 2 * BYTE_NS;
+		moves++;
+		frames += stats.spi_frames;
+		wire_ns += stats.wire_ns;
+	}
+
+	if (ok && moves > 0) {
+		out_printf("  %d moves, %d.%02d frames and %d us on the wire per move\n",
+			moves, (int) (frames / moves), (int) (frames * 100 / moves % 100),
+			(int) (wire_ns / 1000 / moves));
+	}
+
+	free_state(state);
+	fb_clear(&local);
+	fb_flush(&local);
+	fb_wait(&local);
+	fb_invalidate(&fb);
+
+	if (!ok) {
+		out_printf("Failed host move test\n");
+		return false;
+	}
+	out_printf("Passed host move test\n");
+	return true;
+}
+
+
+// Tests that an asynchronous write keeps CS low and the driver busy
+// for exactly its wire time, that a write made meanwhile sleeps
+// until it is out instead of spinning, and that fb_flush uses it
+bool test_host_async() {
+	out_printf("Starting host async test\n");
+	uint8_t data[1] = {0x18};
+
+	mat.invalidate_cache();
+	host_reset_stats();
+	uint64_t start = host_now_ns();
+	bool ok = mat.write_digit_all_async(Max7219::MAX7219_DIGIT_0, data, 1) == 0 && mat.busy();
+
+	host_advance_us(2 * BYTE_NS / 1000 - 1);
+	ok = ok && mat.busy() && host_stats().spi_frames == 0;
+	host_advance_us(1);
+	ok = ok && !mat.busy() && host_stats().spi_frames == 1 &&
+		host_stats().last_frame_bytes == 2;
+
+	const host_event_t* rise = host_event_at(host_event_count() - 1);
+	ok = ok && rise != NULL && rise->kind == HOST_PIN_EDGE && rise->value == 1 &&
+		rise->time_ns == start + 2 * BYTE_NS;
+
+	// The second write starts once the first is out, then runs on its own
+	start = host_now_ns();
+	data[0] = 0x24;
+	ok = ok && mat.write_digit_all_async(Max7219::MAX7219_DIGIT_0, data, 1) == 0;
+	data[0] = 0x42;
+	ok = ok && mat.write_digit_all_async(Max7219::MAX7219_DIGIT_0, data, 1) == 0 &&
+		host_now_ns() == start + 2 * BYTE_NS && mat.busy();
+	host_advance_us(2 * BYTE_NS / 1000);
+	ok = ok && !mat.busy() && host_stats().spi_frames == 3 &&
+		host_now_ns() == start + 4 * BYTE_NS;
+
+	// fb_flush returns with its last frame still on the wire, and
+	// fb_wait sleeps until it is out
+	fb_clear(&fb);
+	fb_flush(&fb);
+	fb_wait(&fb);
+	fb_set(&fb, 1, 2, 3, true);
+	host_reset_stats();
+	start = host_now_ns();
+	ok = ok && fb_flush(&fb) == 1 && mat.busy() && host_now_ns() == start &&
+		host_stats().spi_frames == 0;
+	fb_wait(&fb);
+	ok = ok && !mat.busy() && host_stats().spi_frames == 1 &&
+		host_now_ns() == start + 2 * BYTE_NS;
+
+	data[0] = 0;
+	mat.write_digit_all(Max7219::MAX7219_DIGIT_0, data, 1);
+	fb_clear(&fb);
+	fb_invalidate(&fb);
+
+	if (!ok) {
+		out_printf("Failed host async test\n");
+		return false;
+	}
+	out_printf("Passed host async test\n");
+	return true;
+}
+
+
+// Draws a bot's move as play() does, then lets one grayscale cycle
+// pass before the next key, as a player's pause would
+static void show_paced(state_t* state, char key, move_result result) {
+	show_move(state, key, result);
+	if (key != 0) {
+		host_advance_us(GRAY_CYCLE_US);
+	}
+}
+
+
+// Tests that bots play through show_move, the display path of
+// play(), and that it drives both the terminal and the LEDs: with
+// a grayscale cycle between keys, every plane goes out after every
+// move
+bool test_host_play() {
+	out_printf("Starting host play test\n");
+	bot_stats_t stats;
+	uint dropped = dropped_output();
+
+	host_echo(false);
+	host_reset_stats();
+	run_bot(BOT_SOLVER, 0, 3, 2000, &show_paced, &stats);
+	host_stats_t bus = host_stats();
+	show_stop();
+	term_end();
+	out_flush();
+	host_echo(true);
+
+	bool ok = stats.completed == 3 && stats.moves > 0 &&
+		bus.spi_frames >= stats.moves * GRAY_PLANES && dropped_output() == dropped &&
+		stats.p50_us >= GRAY_CYCLE_US;
+	if (stats.moves > 0) {
+		out_printf("  %d paced moves, %d.%02d frames and %d us on the wire per move\n",
+			stats.moves, (int) (bus.spi_frames / stats.moves),
+			(int) (bus.spi_frames * 100 / stats.moves % 100),
+			(int) (bus.wire_ns / 1000 / stats.moves));
+	}
+	fb_invalidate(&fb);
+
+	if (!ok) {
+		out_printf("Failed host play test\n");
+		return false;
+	}
+	out_printf("Passed host play test\n");
+	return true;
+}
+
+
+// Tests that a maze saved to disk maps back through mazefile_open
+// cell for cell, and that close releases the view
+bool test_host_mazefile() {
+	out_printf("Starting host maze file test\n");
+	char path[] = "/tmp/maze_test_XXXXXX";
+	int fd = mkstemp(path);
+	FILE* out = fd >= 0 ? fdopen(fd, "wb") : NULL;
+
+	srand(5);
+	maze_t* maze = init_maze(21, 9);
+	bool ok = out != NULL && maze != NULL && mazefile_save(maze, out) == 0;
+	if (out != NULL) {
+		ok = fclose(out) == 0 && ok;
+	}
+
+	mazefile_t file;
+	ok = ok && mazefile_open(&file, path) == 0 && file.mapped &&
+		file.width == maze->width && file.height == maze->height &&
+		points_equal(file.start, maze->start) && points_equal(file.exit, maze->exit);
+	for (int y = 0; ok && y < maze->height; y++) {
+		for (int x = 0; ok && x < maze->width; x++) {
+			ok = mazefile_at(&file, x, y) == maze_at(maze, x, y);
+		}
+	}
+	if (ok) {
+		mazefile_close(&file);
+		ok = !file.mapped && file.data == NULL && file.width == 0;
+	}
+
+	// Missing and empty files are errors, not crashes
+	if (fd >= 0) {
+		out = fopen(path, "wb");
+		ok = ok && out != NULL;
+		if (out != NULL) {
+			fclose(out);
+		}
+		ok = ok && mazefile_open(&file, path) != 0;
+		unlink(path);
+		ok = ok && mazefile_open(&file, path) != 0;
+	}
+	free_maze(maze);
+
+	if (!ok) {
+		out_printf("Failed host maze file test\n");
+		return false;
+	}
+	out_printf("Passed host maze file test\n");
+	return true;
+}
+
+
+// Board end of the client test: answers frames from fd through the
+// same session code as the board's binary mode until fd closes
+static void serve_client(int fd) {
+	proto_parser_t parser;
+	proto_reset(&parser);
+	session_t session;
+	session_init(&session);
+
+	uint8_t byte;
+	while (read(fd, &byte, 1) == 1) {
+		if (proto_feed(&parser, byte) == 1) {
+			uint8_t frame[PROTO_MAX_FRAME];
+			size_t len = session_answer(&session, parser.payload, parser.len, frame);
+			if (write(fd, frame, len) != (ssize_t) len) {
+				break;
+			}
+		}
+	}
+	session_free(&session);
+}
+
+
+// Tests that the host client and the board's protocol code agree:
+// a START and moves framed with CRC-8 over a socket come back as the
+// statuses a local game predicts, and a corrupted frame is dropped
+bool test_host_client() {
+	out_printf("Starting host client test\n");
+	const int32_t seed = 1234;
+	discard_maze();
+
+	int fds[2];
+	bool ok = socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0;
+	pid_t board = -1;
+	if (ok) {
+		out_flush();
+		fflush(stdout);
+		board = fork();
+		if (board == 0) {
+			close(fds[0]);
+			serve_client(fds[1]);
+			_exit(0);
+		}
+		close(fds[1]);
+		ok = board > 0;
+	}
+
+	// A board that stops answering fails the test instead of hanging it
+	maze_client_t client;
+	client_attach(&client, ok ? fds[0] : -1);
+	struct timeval timeout = {2, 0};
+	ok = ok && setsockopt(client.fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0;
+
+	srand(seed);
+	state_t* local = init_state();
+	proto_status_t status;
+	ok = ok && local != NULL && client_start(&client, seed, &status) == 0 &&
+		status.flags == 0 && status.turns == 0 &&
+		status.x == local->curr_pos.x && status.y == local->curr_pos.y;
+
+	// Every key answers with what the same key does to the local game
+	const char* keys = "dswaxddssaawwq";
+	int moved = 0;
+	for (const char* key = keys; ok && *key != '\0'; key++) {
+		move_result result = apply_input(*key, local);
+		uint8_t flags = result == MOVE_INVALID ? PROTO_INVALID :
+			result == MOVE_BLOCKED ? PROTO_BLOCKED : 0;
+		if (local->game_complete) {
+			flags |= PROTO_WON;
+		}
+		moved += result == MOVE_OK || result == MOVE_WON;
+		ok = client_move(&client, *key, &status) == 0 && status.flags == flags &&
+			status.x == local->curr_pos.x && status.y == local->curr_pos.y &&
+			status.turns == local->turns;
+	}
+	ok = ok && moved > 0;
+
+	// A move with a bad CRC gets no answer and does not move; the next
+	// good frame is answered as usual
+	uint8_t payload = 'd';
+	uint8_t frame[PROTO_MAX_FRAME];
+	size_t len = proto_encode(&payload, 1, frame);
+	frame[len - 1] ^= 0x5A;
+	ok = ok && write(client.fd, frame, len) == (ssize_t) len;
+	ok = ok && client_move(&client, 'x', &status) == 0 && status.flags == PROTO_INVALID &&
+		status.turns == local->turns && client.parser.errors == 0;
+
+	client_close(&client);
+	free_state(local);
+	int code = -1;
+	if (board > 0) {
+		ok = waitpid(board, &code, 0) == board && ok && WIFEXITED(code) && WEXITSTATUS(code) == 0;
+	}
+
+	if (!ok) {
+		out_printf("Failed host client test\n");
+		return false;
+	}
+	out_printf("Passed host client test\n");
+	return true;
+}
+
+
+// Host test runner
+int run_host_tests() {
+	int passed = 0;
+	int failed = 0;
+
+	// Drained after every test, like run_tests
+	if (test_host_frame()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_host_move()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_host_async()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_host_play()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_host_mazefile()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_host_client()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (passed) {
+		out_printf("Passed %d host tests\n", passed);
+	}
+	if (failed) {
+		out_printf("Failed %d host tests\n", failed);
+	}
+	out_printf("\n");
+	return failed;
+}
@@ -0,0 +1,57 @@
+/*
+ * test_host.h
+ *
+ * Tests that check the traffic the game puts on the SPI bus, using
+ * the host build's accounting, and the parts that need a POSIX
+ * host. Only built on the host.
+ */
+
+#ifndef TEST_HOST_H_
+#define TEST_HOST_H_
+
+#include "main.h"
+#include "host.h"
+#include "mazefile.h"
+#include "session.h"
+#include "maze_client.h"
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * Max7219 frame size and wire time test.
+ */
+bool test_host_frame();
+
+/**
+ * Frames sent per player move test.
+ */
+bool test_host_move();
+
+/**
+ * Asynchronous Max7219 transfer timing test.
+ */
+bool test_host_async();
+
+/**
+ * Bot play through the game's display path test.
+ */
+bool test_host_play();
+
+/**
+ * Maze file mapped from disk test.
+ */
+bool test_host_mazefile();
+
+/**
+ * Host client against the board's protocol code test.
+ */
+bool test_host_client();
+
+/**
+ * Host test runner. Returns the number of failed tests.
+ */
+int run_host_tests();
+
+#endif /* TEST_HOST_H_ */
@@ -0,0 +1,428 @@
+/*
+ * image.cpp
+ *
+ */
+
+#include "image.h"
+
+/*---------------------------------------------------------------
+  Pixel rows
+ *---------------------------------------------------------------*/
+
+// Bytes in one packed image row
+static size_t row_bytes(const maze_t* maze) {
+	return (2 * (size_t) maze->width + 1 + 7) / 8;
+}
+
+
+static void set_pixel(uint8_t* row, size_t i) {
+	row[i >> 3] |= 0x80 >> (i & 7);
+}
+
+
+// Packs image row r, most significant bit first, 1 for a wall.
+// Row 0 is the top border, odd rows run through cells and even rows
+// through their south walls.
+static void pixel_row(const maze_t* maze, int r, uint8_t* row) {
+	size_t pixels = 2 * (size_t) maze->width + 1;
+	memset(row, 0, row_bytes(maze));
+
+	if (r == 0) {
+		for (size_t i = 0; i < pixels; i++) {
+			set_pixel(row, i);
+		}
+		return;
+	}
+
+	int y = (r - 1) / 2;
+	bool floor = (r % 2) == 0;
+
+	set_pixel(row, 0);
+	for (int x = 0; x < maze->width; x++) {
+		cell c = maze_at(maze, x, y);
+		size_t i = 2 * (size_t) x + 1;
+		if (floor) {
+			if (!can_move(SOUTH, c)) {
+				set_pixel(row, i);
+			}
+			set_pixel(row, i + 1);
+		} else if (!can_move(EAST, c)) {
+			set_pixel(row, i + 1);
+		}
+	}
+}
+
+
+/*---------------------------------------------------------------
+  PBM
+ *---------------------------------------------------------------*/
+
+// Header, then packed rows exactly as pixel_row builds them
+int image_write_pbm(const maze_t* maze, FILE* out) {
+	size_t len = row_bytes(maze);
+	uint8_t* row = (uint8_t*) malloc(len);
+	if (row == NULL) {
+		return -1;
+	}
+
+	int rows = 2 * maze->height + 1;
+	int rtn_val = 0;
+	if (fprintf(out, "P4\n%d %d\n", 2 * maze->width + 1, rows) < 0) {
+		rtn_val = -1;
+	}
+
+	for (int r = 0; r < rows && rtn_val == 0; r++) {
+		pixel_row(maze, r, row);
+		if (fwrite(row, 1, len, out) != len) {
+			rtn_val = -1;
+		}
+	}
+
+	free(row);
+	return rtn_val;
+}
+
+
+/*---------------------------------------------------------------
+  Deflate
+ *---------------------------------------------------------------*/
+
+// Fixed Huffman deflate with matches at distance 1 (runs) and at
+// the row stride (repeats of the row above), which is where nearly
+// all of a maze image's redundancy is. Each band of rows is its own
+// block and falls back to a stored block when coding would grow it,
+// as it does for dense mazes drawn at one pixel per cell.
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+#define MAX_DISTANCE 32768
+#define MAX_STORED 65535
+
+static const uint16_t length_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t distance_base[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t distance_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+typedef struct {
+	FILE* out;
+	int error;
+
+	// Compressed bytes waiting to go out as an IDAT chunk
+	uint8_t* buf;
+	size_t len;
+	size_t cap;
+	uint32_t bits;
+	int nbits;
+
+	// Previous and current filtered rows, back to back
+	uint8_t* window;
+	size_t stride;
+	bool have_prev;
+
+	// Uncompressed rows of the current band
+	uint8_t* band;
+	size_t band_len;
+
+	uint32_t adler_a;
+	uint32_t adler_b;
+} png_t;
+
+static uint32_t crc_table[256];
+
+
+static void init_crc_table() {
+	if (crc_table[1] != 0) {
+		return;
+	}
+	for (uint32_t n = 0; n < 256; n++) {
+		uint32_t c = n;
+		for (int k = 0; k < 8; k++) {
+			c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		}
+		crc_table[n] = c;
+	}
+}
+
+
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t len) {
+	crc = ~crc;
+	for (size_t i = 0; i < len; i++) {
+		crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+
+static void put_u32(uint8_t* p, uint32_t v) {
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+
+// Writes a PNG chunk with its length and CRC
+static void write_chunk(png_t* png, const char* type, const uint8_t* data, size_t len) {
+	uint8_t head[8];
+	uint8_t tail[4];
+	put_u32(head, len);
+	memcpy(&head[4], type, 4);
+	uint32_t crc = crc32(crc32(0, &head[4], 4), data, len);
+	put_u32(tail, crc);
+
+	if (fwrite(head, 1, 8, png->out) != 8 ||
+		(len > 0 && fwrite(data, 1, len, png->out) != len) ||
+		fwrite(tail, 1, 4, png->out) != 4)
+	{
+		png->error = -1;
+	}
+}
+
+
+// Appends bits, least significant first
+static void put_bits(png_t* png, uint32_t value, int n) {
+	png->bits |= value << png->nbits;
+	png->nbits += n;
+	while (png->nbits >= 8) {
+		png->buf[png->len++] = png->bits & 0xFF;
+		png->bits >>= 8;
+		png->nbits -= 8;
+	}
+}
+
+
+// Huffman codes are sent most significant bit first
+static void put_code(png_t* png, uint32_t code, int n) {
+	uint32_t reversed = 0;
+	for (int i = 0; i < n; i++) {
+		reversed = (reversed << 1) | ((code >> i) & 1);
+	}
+	put_bits(png, reversed, n);
+}
+
+
+// Fixed literal/length code for symbol 0-285
+static void put_symbol(png_t* png, int sym) {
+	if (sym < 144) {
+		put_code(png, 0x30 + sym, 8);
+	} else if (sym < 256) {
+		put_code(png, 0x190 + sym - 144, 9);
+	} else if (sym < 280) {
+		put_code(png, sym - 256, 7);
+	} else {
+		put_code(png, 0xC0 + sym - 280, 8);
+	}
+}
+
+
+static void put_match(png_t* png, int length, int distance) {
+	int i = 28;
+	while (length_base[i] > length) {
+		i--;
+	}
+	put_symbol(png, 257 + i);
+	put_bits(png, length - length_base[i], length_extra[i]);
+
+	int j = 29;
+	while (distance_base[j] > distance) {
+		j--;
+	}
+	put_code(png, j, 5);
+	put_bits(png, distance - distance_base[j], distance_extra[j]);
+}
+
+
+// Length of the match for cur[i..] at distance back in the window
+static int match_length(png_t* png, size_t i, size_t distance) {
+	uint8_t* cur = png->window + png->stride;
+	size_t limit = png->stride - i;
+	if (limit > MAX_MATCH) {
+		limit = MAX_MATCH;
+	}
+
+	size_t n = 0;
+	while (n < limit && cur[i + n] == cur[i + n - distance]) {
+		n++;
+	}
+	return n;
+}
+
+
+// Compresses the filtered row in the second half of the window
+static void compress_row(png_t* png) {
+	uint8_t* cur = png->window + png->stride;
+
+	for (size_t i = 0; i < png->stride; i++) {
+		png->adler_a = (png->adler_a + cur[i]) % 65521;
+		png->adler_b = (png->adler_b + png->adler_a) % 65521;
+	}
+	memcpy(&png->band[png->band_len], cur, png->stride);
+	png->band_len += png->stride;
+
+	size_t i = 0;
+	while (i < png->stride) {
+		int best = 0;
+		int distance = 0;
+
+		if (i > 0 || png->have_prev) {
+			best = match_length(png, i, 1);
+			distance = 1;
+		}
+		if (png->have_prev && png->stride <= MAX_DISTANCE) {
+			int above = match_length(png, i, png->stride);
+			if (above > best) {
+				best = above;
+				distance = png->stride;
+			}
+		}
+
+		if (best >= MIN_MATCH) {
+			put_match(png, best, distance);
+			i += best;
+		} else {
+			put_symbol(png, cur[i]);
+			i++;
+		}
+	}
+
+	memcpy(png->window, cur, png->stride);
+	png->have_prev = true;
+}
+
+
+// Compresses the band's rows as one fixed Huffman block, replacing
+// it with stored blocks if that is smaller
+static void compress_band(png_t* png, int first, int last, const maze_t* maze) {
+	size_t saved_len = png->len;
+	uint32_t saved_bits = png->bits;
+	int saved_nbits = png->nbits;
+
+	png->band_len = 0;
+	put_bits(png, 0, 1);
+	put_bits(png, 1, 2);
+
+	uint8_t* cur = png->window + png->stride;
+	for (int r = first; r < last; r++) {
+		// PNG grayscale is 0 for black, so invert the wall bits
+		cur[0] = 0;
+		pixel_row(maze, r, &cur[1]);
+		for (size_t i = 1; i < png->stride; i++) {
+			cur[i] = ~cur[i];
+		}
+		compress_row(png);
+	}
+	put_symbol(png, 256);
+
+	size_t coded = (png->len - saved_len) * 8 + png->nbits - saved_nbits;
+	size_t blocks = png->band_len / MAX_STORED + 1;
+	if (coded <= (png->band_len + blocks * 5) * 8) {
+		return;
+	}
+
+	// Undo the coded block and store the rows as they are
+	png->len = saved_len;
+	png->bits = saved_bits;
+	png->nbits = saved_nbits;
+	for (size_t pos = 0; pos < png->band_len; pos += MAX_STORED) {
+		size_t n = png->band_len - pos;
+		if (n > MAX_STORED) {
+			n = MAX_STORED;
+		}
+		put_bits(png, 0, 3);
+		if (png->nbits > 0) {
+			put_bits(png, 0, 8 - png->nbits);
+		}
+		put_bits(png, n, 16);
+		put_bits(png, ~n & 0xFFFF, 16);
+		memcpy(&png->buf[png->len], &png->band[pos], n);
+		png->len += n;
+	}
+}
+
+
+/*---------------------------------------------------------------
+  PNG
+ *---------------------------------------------------------------*/
+
+// Signature, header, one IDAT chunk per maze row, end
+int image_write_png(const maze_t* maze, FILE* out) {
+	static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	png_t png;
+	memset(&png, 0, sizeof(png_t));
+	png.out = out;
+	png.stride = row_bytes(maze) + 1;
+	png.adler_a = 1;
+
+	// Two rows at up to 9 bits per byte, plus block, zlib header and
+	// trailer overhead
+	png.cap = 2 * png.stride * 9 / 8 + 32;
+	png.buf = (uint8_t*) malloc(png.cap);
+	png.window = (uint8_t*) malloc(2 * png.stride);
+	png.band = (uint8_t*) malloc(2 * png.stride);
+	if (png.buf == NULL || png.window == NULL || png.band == NULL) {
+		free(png.buf);
+		free(png.window);
+		free(png.band);
+		return -1;
+	}
+
+	init_crc_table();
+
+	uint8_t ihdr[13];
+	put_u32(&ihdr[0], 2 * maze->width + 1);
+	put_u32(&ihdr[4], 2 * maze->height + 1);
+	ihdr[8] = 1;	// bit depth
+	ihdr[9] = 0;	// grayscale
+	ihdr[10] = 0;	// deflate
+	ihdr[11] = 0;	// no filtering
+	ihdr[12] = 0;	// not interlaced
+
+	if (fwrite(signature, 1, 8, out) != 8) {
+		png.error = -1;
+	}
+	write_chunk(&png, "IHDR", ihdr, 13);
+
+	// zlib header
+	png.buf[png.len++] = 0x78;
+	png.buf[png.len++] = 0x01;
+
+	// Top border on its own, then the two image rows of each maze row,
+	// sending whole bytes as a chunk and keeping partial bits
+	int rows = 2 * maze->height + 1;
+	for (int r = 0; r < rows && png.error == 0; r += (r == 0 ? 1 : 2)) {
+		compress_band(&png, r, r == 0 ? 1 : r + 2, maze);
+		if (png.len > 0) {
+			write_chunk(&png, "IDAT", png.buf, png.len);
+			png.len = 0;
+		}
+	}
+
+	// Empty final block, pad to a byte, then the Adler-32 of the data
+	put_bits(&png, 1, 1);
+	put_bits(&png, 1, 2);
+	put_symbol(&png, 256);
+	if (png.nbits > 0) {
+		put_bits(&png, 0, 8 - png.nbits);
+	}
+	put_u32(&png.buf[png.len], (png.adler_b << 16) | png.adler_a);
+	png.len += 4;
+	write_chunk(&png, "IDAT", png.buf, png.len);
+	write_chunk(&png, "IEND", NULL, 0);
+
+	free(png.buf);
+	free(png.window);
+	free(png.band);
+	return png.error;
+}
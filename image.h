@@ -0,0 +1,33 @@
+/*
+ * image.h
+ *
+ * Streaming image export of mazes. Walls are black and passages
+ * white, one pixel per cell and per wall, so a W x H maze becomes a
+ * (2W + 1) x (2H + 1) image. Images are produced one maze row at a
+ * time, so memory use is proportional to the width only.
+ */
+
+#ifndef IMAGE_H_
+#define IMAGE_H_
+
+#include "mbed.h"
+#include "maze.h"
+
+
+/*---------------------------------------------------------------
+  Image functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Writes a maze as a binary PBM (P4) image.
+ * Returns 0 on success, -1 on error.
+ */
+int image_write_pbm(const maze_t* maze, FILE* out);
+
+/**
+ * Writes a maze as a 1-bit grayscale PNG, compressed with the
+ * built-in deflate encoder. Returns 0 on success, -1 on error.
+ */
+int image_write_png(const maze_t* maze, FILE* out);
+
+#endif /* IMAGE_H_ */
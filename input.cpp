@@ -0,0 +1,119 @@
+/*
+ * input.cpp
+ *
+ */
+
+#include "input.h"
+
+/*---------------------------------------------------------------
+  Receive queue
+ *---------------------------------------------------------------*/
+
+// Queue size, must be a power of two
+#define INPUT_SIZE 64
+
+// Single-producer/single-consumer ring buffer. The RX interrupt is
+// the only writer of head and the game loop the only writer of
+// tail, so no locking is needed. Both count up forever and are
+// masked on access.
+static volatile char queue[INPUT_SIZE];
+static volatile uint head = 0;
+static volatile uint tail = 0;
+static volatile uint dropped = 0;
+
+static RawSerial* input_serial;
+
+// Work to do instead of sleeping while waiting for a key
+static bool (*idle_hook)() = NULL;
+
+
+// RX interrupt: move everything the UART has into the queue
+static void on_receive() {
+	while (input_serial->readable()) {
+		char c = input_serial->getc();
+		if (head - tail < INPUT_SIZE) {
+			queue[head & (INPUT_SIZE - 1)] = c;
+			head = head + 1;
+		} else {
+			dropped = dropped + 1;
+		}
+	}
+}
+
+
+/*---------------------------------------------------------------
+  Input functions
+ *---------------------------------------------------------------*/
+
+// Hooks up the RX interrupt
+void init_input(RawSerial* serial) {
+	input_serial = serial;
+	input_serial->attach(&on_receive, SerialBase::RxIrq);
+}
+
+
+// Installs or removes the idle function
+void set_idle(bool (*idle)()) {
+	idle_hook = idle;
+}
+
+
+// True if a key is waiting
+bool key_ready() {
+	return head != tail;
+}
+
+
+// Looks at the oldest key, sleeping until one arrives unless the
+// idle function has work to do
+char peek_key() {
+	while (!key_ready()) {
+		if (idle_hook == NULL || !idle_hook()) {
+			sleep();
+		}
+	}
+	return queue[tail & (INPUT_SIZE - 1)];
+}
+
+
+// Takes the oldest key, sleeping until one arrives
+char read_key() {
+	char c = peek_key();
+	tail = tail + 1;
+	return c;
+}
+
+
+// Drops queued keys
+void flush_keys() {
+	tail = head;
+}
+
+
+// Parses an optionally signed decimal number
+int read_number() {
+	char c = read_key();
+	while (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+		c = read_key();
+	}
+
+	bool negative = false;
+	if (c == '-' || c == '+') {
+		negative = (c == '-');
+		c = read_key();
+	}
+
+	int value = 0;
+	while ('0' <= c && c <= '9') {
+		value = value * 10 + (c - '0');
+		c = read_key();
+	}
+
+	return negative ? -value : value;
+}
+
+
+// Keys lost to a full queue
+uint dropped_keys() {
+	return dropped;
+}
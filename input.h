@@ -0,0 +1,64 @@
+/*
+ * input.h
+ *
+ * Interrupt-driven keyboard input from the serial console.
+ */
+
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include "mbed.h"
+
+
+/*---------------------------------------------------------------
+  Input functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Starts queueing every character received on serial from its
+ * RX interrupt. Must be called before any other input function.
+ */
+void init_input(RawSerial* serial);
+
+/**
+ * Sets a function to run while waiting for a keystroke, instead of
+ * sleeping. It should do a short slice of work and return true if
+ * it has more to do; while it returns false the wait sleeps as
+ * usual. NULL removes it.
+ */
+void set_idle(bool (*idle)());
+
+/**
+ * Returns true if a keystroke is waiting in the queue.
+ */
+bool key_ready();
+
+/**
+ * Returns the next queued keystroke, sleeping or running the idle
+ * function until one arrives.
+ */
+char read_key();
+
+/**
+ * Returns the next queued keystroke without removing it, sleeping
+ * until one arrives.
+ */
+char peek_key();
+
+/**
+ * Discards every queued keystroke.
+ */
+void flush_keys();
+
+/**
+ * Reads a decimal integer, skipping leading whitespace. Consumes
+ * the character that ends the number.
+ */
+int read_number();
+
+/**
+ * Returns the number of keystrokes lost because the queue was full.
+ */
+uint dropped_keys();
+
+#endif /* INPUT_H_ */
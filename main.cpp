@@ -18,8 +18,9 @@ InterruptIn testButton(SW2);
 // Play button
 InterruptIn playButton(SW3);
 
-// Set up serial over USB
-Serial pc(USBTX, USBRX);
+// Set up serial over USB. RawSerial so it can be read from the RX
+// interrupt.
+RawSerial pc(USBTX, USBRX);
 
 // Set up LED matrix on SPI0
 Max7219 mat(PTD2, PTD3, PTD1, PTD0);
@@ -27,6 +28,17 @@ Max7219 mat(PTD2, PTD3, PTD1, PTD0);
 // Device number for LED matrix
 uint8_t MATRIX = 1;
 
+// What the LED matrix should show; flushed after each change
+framebuffer_t fb;
+
+// Devices across and down the LED chain, e.g. 4 and 1 for a 32x8
+// strip or 2 and 2 for a 16x16 square
+#define VIEW_COLS 1
+#define VIEW_ROWS 1
+
+// How the modules are mounted, as ORIENT_ flags from transform.h
+#define VIEW_ORIENT ORIENT_NORMAL
+
 // Flag for board mode (0: play, 1: testing, 2: wait)
 volatile int MODE = 2;
 
@@ -43,70 +55,56 @@ void setPlay() {
 	MODE = 0;
 }
 
-/*---------------------------------------------------------------
-  Main game functions
- *---------------------------------------------------------------*/
+// Work done while waiting for keys: LED animations, and building
+// the next round's maze
+bool idle() {
+	bool drew = anim_poll();
+	return prepare_step() || drew;
+}
+
 
 // Prompts user until receives 'y' or 'n'
 // Returns true if receives 'y' else false
 bool yes_no() {
 	while (true) {
-		printf("y/n ");
-		switch (pc.getc()) {
+		out_printf("y/n ");
+		switch (read_key()) {
 		case 'y':
 		case 'Y':
-			printf("\n");
+			out_printf("\n");
 			return true;
 		case 'n':
 		case 'N':
-			printf("\n");
+			out_printf("\n");
 			return false;
 		default:
 			// prompt again for input
-			printf("\ntype 'y' or 'n' ");
+			out_printf("\ntype 'y' or 'n' ");
 		}
 	}
 }
 
 
-// Prints the state to console
-void display(state_t* state) {
-
-	maze_t* maze = state->maze;
-
-	// Print top of maze
-	printf(" ");
-	for (int i = 0; i < WIDTH * 2 - 1; i++) {
-		printf("_");
-	}
-	printf("\n");
-
-	for (int i = 0; i < HEIGHT; i++) {
-		printf("|");
-		for (int j = 0; j < WIDTH; j++) {
-			cell curr = maze->grid[i][j];
-
-			if (can_move(SOUTH, curr)) {
-				printf(" ");
-			} else {
-				printf("_");
-			}
-
-			if (can_move(EAST, curr)) {
-				cell next = curr;
-				if (j < WIDTH - 1) {
-					next = maze->grid[i][j+1];
-				}
-				if (can_move(SOUTH, curr) | can_move(SOUTH, next)) {
-					printf(" ");
-				} else {
-					printf("_");
-				}
-			} else {
-				printf("|");
-			}
+// Asks a yes/no question on the prompt row of the held screen
+// Returns true if receives 'y' else false
+bool ask(const char* question) {
+	while (true) {
+		term_line(ROW_PROMPT, "%s y/n ", question);
+		term_cursor(ROW_PROMPT, strlen(question) + 5);
+		term_flush();
+		switch (read_key()) {
+		case 'y':
+		case 'Y':
+			term_clear(ROW_MESSAGE, ROW_PROMPT + 1);
+			return true;
+		case 'n':
+		case 'N':
+			term_clear(ROW_MESSAGE, ROW_PROMPT + 1);
+			return false;
+		default:
+			// prompt again for input
+			term_line(ROW_MESSAGE, "type 'y' or 'n'");
 		}
-		printf("\n");
 	}
 }
 
@@ -114,108 +112,185 @@ void display(state_t* state) {
 // Individual game loop
 void play (state_t* state){
 
+	// Only the fields that change are redrawn between moves. The
+	// screen stays held after the win, for the next prompt.
+	term_begin();
+	show_start(state->maze->width, state->maze->height, state->curr_pos);
+
 	// While game is not completed yet (player hasn't arrived at finish)
 	while (state->game_complete == 0){
 
-		// Get current position
-		point_t curr_p = state->curr_pos;
-		cell curr_c = state->maze->grid[curr_p.y][curr_p.x];
+		// Status, prompt and LED for the current position
+		show_turn(state);
+
+		// Wait for a key, then apply every key typed ahead of it before
+		// rendering again
+		char c = read_key();
+		while (true) {
+			show_result(c, apply_input(c, state));
+
+			if (state->game_complete || !key_ready()) {
+				break;
+			}
+			c = read_key();
+		}
+	}
+
+	// Player has arrived at the exit
+	term_clear(ROW_POSITION, TERM_ROWS);
+	term_line(ROW_POSITION, "Congratulations! You have won in %d moves.", state->turns);
+	term_maze(ROW_MAZE, state->maze);
+	term_flush();
 
-		// If current position is the exit, game is finished
-		if (points_equal(curr_p, state->maze->exit)) {
-			state->game_complete = 1;
+	// Blink LED matrix, 10 times at 0.1s per phase, while the game
+	// goes on to the next prompt
+	show_stop();
+	anim_blink(10, ANIM_FPS / 10);
 
-			printf("\nCongratulations! You have won in %d moves.\n", state->turns);
+	// Drop anything typed past the exit
+	flush_keys();
+}
 
-			// Blink LED matrix
-			for (int i = 0; i < 10; i++) {
-				mat.device_all_on(1);
-				wait(0.1);
+// Endless game loop over a world generated chunk by chunk.
+// There is no exit; q stops the game.
+void play_endless(int seed) {
+	static world_t world;
+	init_world(&world, seed);
+	point_t pos = {0, 0};
+	uint turns = 0;
 
-				mat.device_all_off(1);
-				wait(0.1);
+	term_begin();
+	show_start(0, 0, pos);
+
+	while (true) {
+		term_line(ROW_POSITION, "You're currently at position %d, %d", pos.y, pos.x);
+		term_line(ROW_TURNS, "Turns: %d", turns);
+		term_line(ROW_PROMPT, "Input a direction (q to quit): ");
+		term_cursor(ROW_PROMPT, 31);
+		term_flush();
+
+		// Update LED, scrolling through the world
+		show_position(pos);
+
+		// Apply every queued key before rendering again
+		char c = read_key();
+		while (true) {
+			if (c == 'q') {
+				show_stop();
+				term_end();
+				flush_keys();
+				return;
 			}
 
-			display(state);
-			printf("\n");
+			direction d = interpret(c);
+			if (d == NONE) {
+				term_line(ROW_MESSAGE, "Try a valid direction (use WASD)");
+			} else {
+				turns = turns + 1;
+				if (can_move(d, world_at(&world, pos.x, pos.y))) {
+					step(d, &pos);
+					term_line(ROW_MESSAGE, "");
+				} else {
+					term_line(ROW_MESSAGE, "You can't go %s here!", direction_name(d));
+				}
+			}
 
-			return;
+			if (!key_ready()) {
+				break;
+			}
+			c = read_key();
 		}
+	}
+}
 
-		printf("You're currently at position %d, %d\n", curr_p.y, curr_p.x);
 
-		// Update LED
-		mat.device_all_off(MATRIX);
-		mat.write_digit(1, 1 + curr_p.x, 1 << curr_p.y);
-
-		// Intended direction d and current cell
-		printf("Input a direction: ");
-		direction d = interpret(getchar());
-		printf("\n");
-		while (d == NONE) {
-			printf("Try a valid direction (use WASD): ");
-			d = interpret(getchar());
-			printf("\n");
-		}
+// Binary protocol game loop, for bots and host programs. Every
+// request frame is answered with one status frame.
+void play_binary() {
+	proto_parser_t parser;
+	proto_reset(&parser);
+	session_t session;
+	session_init(&session);
 
-		if (can_move(d, curr_c)) {
-			// Update current position
-			take_step(d, state);
-		} else {
-			printf("You can't go ");
-			print_direction(d);
-			printf(" here!\n");
+	while (true) {
+		if (proto_feed(&parser, read_key()) != 1) {
+			continue;
 		}
 
-		printf("\n");
-
-		state->turns = state->turns + 1;
+		uint8_t frame[PROTO_MAX_FRAME];
+		size_t len = session_answer(&session, parser.payload, parser.len, frame);
+		out_write(frame, len);
 
+		// Update LED
+		state_t* state = session.state;
+		if (state != NULL && parser.len == 5 && parser.payload[0] == PROTO_START) {
+			show_start(state->maze->width, state->maze->height, state->curr_pos);
+		} else if (state != NULL) {
+			show_position(state->curr_pos);
+		}
 	}
 }
 
+
 // Callback to start main game loop
 void play_game() {
 	// As for input to seed random generator if not testing
-	printf("Enter a random number to setup the maze game: ");
-	int seed;
-	scanf("%20d", &seed);
+	out_printf("Enter a random number to setup the maze game: ");
+
+	// A frame instead of a number switches to the binary protocol
+	if (peek_key() == (char) PROTO_SYNC) {
+		play_binary();
+		return;
+	}
+
+	int seed = read_number();
 	srand(seed);
 
+	out_printf("\nDo you want to play endless mode? ");
+	if (yes_no()) {
+		play_endless(seed);
+		return;
+	}
+
+	// Every round draws into the same held screen, so it is only
+	// cleared once and a new round resends just what changed
+	term_begin();
 	while (1) {
-		printf("Welcome to the invisible maze!\n");
+		term_clear(0, TERM_ROWS);
+		term_line(ROW_POSITION, "Welcome to the invisible maze!");
 
-		mat.device_all_off(MATRIX);
+		anim_stop();
 		led1.write(1);
 
-		printf("\n");
-
 		state_t* state = init_state();
-
-		printf("Do you want to see the maze? ");
-		if (yes_no()) {
-			printf("\n");
-			display(state);
+		if (state == NULL) {
+			term_line(ROW_MESSAGE, "Out of memory for a new maze");
+			term_flush();
+			break;
+		}
+		// init_state has just taken the spare, so this starts the
+		// next round's maze rather than rebuilding this one
+		prepare_maze(WIDTH, HEIGHT);
+
+		if (ask("Do you want to see the maze?")) {
+			// Show the maze where play() draws its status, which
+			// overwrites it on the first move
+			term_maze(ROW_MAZE, state->maze);
+			term_flush();
 			wait(5);
-			// Clear screen
-			pc.putc(27);
-			pc.printf("[2J");
-			// Set cursor to home
-			pc.putc(27);
-			pc.printf("[H");
+			term_clear(ROW_MAZE, TERM_ROWS);
 		}
 
 		play(state);
+		free_state(state);
 
-		printf("Play again? ");
-		if (yes_no()) {
-			printf("\n");
-			continue;
-		} else {
-			printf("\n");
+		if (!ask("Play again?")) {
 			break;
 		}
 	}
+	term_end();
+
+	discard_maze();
 }
 
 
@@ -229,16 +304,27 @@ int main() {
         .scan_limit = Max7219::MAX7219_SCAN_8
     };
 
-    mat.init_device(cfg);
-    mat.enable_device(MATRIX);
-	mat.device_all_off(MATRIX);
+    init_input(&pc);
+    init_output(&pc);
+
+    mat.set_num_devices(VIEW_COLS * VIEW_ROWS);
+    mat.init_display(cfg);
+    mat.enable_display();
+	fb_init(&fb, &mat, VIEW_COLS * VIEW_ROWS);
+	for (int i = 1; i <= VIEW_COLS * VIEW_ROWS; i++) {
+		fb_orient(&fb, i, VIEW_ORIENT);
+	}
+	fb_flush(&fb);
+	init_anim(&fb);
+	show_init(&fb, VIEW_COLS, VIEW_ROWS);
+	set_idle(&idle);
 	led1.write(1);
 
     // Bind callback functions to buttons
     testButton.rise(&setTest);
     playButton.rise(&setPlay);
 
-    printf("Press SW2 to run tests or press SW3 to run game.\n");
+    out_printf("Press SW2 to run tests or press SW3 to run game.\n");
 
 	// Wait for button to be pressed to set mode
 	while (MODE == 2);
@@ -248,6 +334,11 @@ int main() {
 		play_game();
 	}
 
-	while (true);
+	// Let any animation finish
+	while (true) {
+		if (!idle()) {
+			sleep();
+		}
+	}
 	return 0;
 }
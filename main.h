@@ -9,8 +9,20 @@
 
 #include "mbed.h"
 #include "max7219.h"
+#include "framebuffer.h"
+#include "viewport.h"
+#include "animation.h"
+#include "gray.h"
 #include "maze.h"
 #include "game.h"
+#include "render.h"
+#include "term.h"
+#include "show.h"
+#include "protocol.h"
+#include "session.h"
+#include "world.h"
+#include "input.h"
+#include "output.h"
 #include "test.h"
 
 // Expose red LED for tests
@@ -22,4 +34,7 @@ extern Max7219 mat;
 // Device number for LED matrix exposed for tests
 extern uint8_t MATRIX;
 
+// Framebuffer over the LED matrix exposed for tests
+extern framebuffer_t fb;
+
 #endif /* MAIN_H_ */
@@ -4,6 +4,7 @@
  */
 
 #include "maze.h"
+#include "output.h"
 
 /*---------------------------------------------------------------
   Constants
@@ -41,15 +42,22 @@ direction opposite(direction dir) {
 }
 
 
-// Prints the string representation of a direction
-void print_direction(direction dir) {
+// Gives the string representation of a direction
+const char* direction_name(direction dir) {
 	switch (dir) {
-	case NORTH: printf("north"); break;
-	case SOUTH: printf("south"); break;
-	case EAST: 	printf("east"); break;
-	case WEST:	printf("west"); break;
-	default:	printf("none");
+	case NORTH: return "north";
+	case SOUTH: return "south";
+	case EAST: 	return "east";
+	case WEST:	return "west";
+	default:	return "none";
 	}
+}
+
+
+// Prints the string representation of a direction, queued with the
+// rest of the game's output so it keeps its place
+void print_direction(direction dir) {
+	out_printf("%s", direction_name(dir));
 	return;
 }
 
@@ -77,59 +85,268 @@ bool points_equal (point_t a, point_t b) {
 	return (a.x == b.x) && (a.y == b.y);
 }
 
+
+// Checks if a point is inside the maze
+bool in_bounds(const maze_t* maze, point_t p) {
+	return 0 <= p.x && p.x < maze->width &&
+		0 <= p.y && p.y < maze->height;
+}
+
+
+// Allocates a row-major maze with every wall standing
+maze_t* new_maze(int width, int height) {
+	return new_maze_layout(width, height, LAYOUT_ROWS);
+}
+
+
+// Allocates a maze with every wall standing
+maze_t* new_maze_layout(int width, int height, layout order) {
+	maze_t* maze = (maze_t*) calloc(1, sizeof(maze_t));
+	if (maze == NULL) {
+		return NULL;
+	}
+
+	// Tiled mazes are padded to whole 8x8 tiles
+	maze->width = width;
+	maze->height = height;
+	maze->order = order;
+	maze->tiles_x = (width + 7) / 8;
+
+	maze->cells = (cell*) calloc(maze_cells(maze), sizeof(cell));
+	if (maze->cells == NULL) {
+		free(maze);
+		return NULL;
+	}
+
+	point_t start = {0, 0};
+	point_t end = {width - 1, height - 1};
+	maze->start = start;
+	maze->exit = end;
+
+	return maze;
+}
+
+
+// Frees a maze
+void free_maze(maze_t* maze) {
+	if (maze != NULL) {
+		free(maze->cells);
+		free(maze);
+	}
+}
+
 		
 /*---------------------------------------------------------------
   Maze Generation
  *---------------------------------------------------------------*/
 
-// Generate a maze via recursive backtracking
-void backtrack(point_t pos, grid_t* grid) {
+// Shuffles the four directions via Fisher-Yates Shuffle
+static uint8_t shuffled() {
 	direction dir[] = {NORTH, SOUTH, EAST, WEST};
-	
-	// Shuffle direction array via Fisher-Yates Shuffle
 	for (int i = 3; i >= 0; i--) {
 		 int j = rand() % (i + 1);
 		 direction tmp = dir[j];
 		 dir[j] = dir[i];
 		 dir[i] = tmp;
 	}
+	return dir[0] | (dir[1] << 2) | (dir[2] << 4) | (dir[3] << 6);
+}
+
+
+// Steps per clock check in gen_run_for
+#define GEN_SLICE 32
+
+
+// Generator used by generate, kept so generating mazes of the same
+// size again does not reallocate
+static gen_t scratch;
+
+
+// Sizes the generator buffers and pushes the start cell
+bool gen_begin(gen_t* gen, maze_t* maze) {
+	size_t count = (size_t) maze->width * maze->height;
+	if (count > gen->capacity) {
+		gen_frame_t* grown = (gen_frame_t*) realloc(gen->stack, count * sizeof(gen_frame_t));
+		if (grown == NULL) {
+			return false;
+		}
+		gen->stack = grown;
+		gen->capacity = count;
+	}
+	if (!bitset_reset(&gen->visited, count)) {
+		return false;
+	}
+
+	gen->maze = maze;
+	gen->pos = maze->start;
+	bitset_set(&gen->visited, (size_t) gen->pos.y * maze->width + gen->pos.x);
+	gen->stack[0].order = shuffled();
+	gen->stack[0].tried = 0;
+	gen->top = 1;
+	return true;
+}
+
+
+// Backtracking with an explicit stack, so large mazes do not
+// overflow the call stack and the walk can stop between any two
+// steps. Makes the same rand() calls in the same order as the old
+// recursive version did, so a seed still gives the same maze.
+bool gen_step(gen_t* gen, size_t steps) {
+	maze_t* maze = gen->maze;
+	gen_frame_t* stack = gen->stack;
+	point_t pos = gen->pos;
+	size_t top = gen->top;
+
+	for (; top > 0 && steps > 0; steps--) {
+		gen_frame_t* f = &stack[top - 1];
+
+		// All directions tried, return to the parent cell. The
+		// position is not stored, it is recovered by stepping back
+		// along the direction the parent last tried.
+		if (f->tried == 4) {
+			top--;
+			if (top > 0) {
+				gen_frame_t* parent = &stack[top - 1];
+				direction came = (direction) ((parent->order >> ((parent->tried - 1) * 2)) & 3);
+				step(opposite(came), &pos);
+			}
+			continue;
+		}
+
+		direction d = (direction) ((f->order >> (f->tried * 2)) & 3);
+		f->tried++;
 
-	for (int i = 0; i < 4; i++) {
-		direction d = dir[i];
 		// Go to next coordinate point_t
-		point_t next = {pos.x, pos.y};
-		step (d, &next);
+		point_t next = pos;
+		step(d, &next);
 
-		// Check if next cell is unvisited and in bounds
-		if ((*grid)[next.y][next.x] == 0 &&
-			0 <= next.x && next.x < WIDTH &&
-			0 <= next.y && next.y < HEIGHT)
+		// Check if next cell is in bounds and unvisited
+		if (in_bounds(maze, next) &&
+			!bitset_get(&gen->visited, (size_t) next.y * maze->width + next.x))
 		{
+			bitset_set(&gen->visited, (size_t) next.y * maze->width + next.x);
+
 			// Carve next cell
-			(*grid)[next.y][next.x] = (*grid)[next.y][next.x] | mask_of(opposite(d));
+			maze_set(maze, next.x, next.y, maze_at(maze, next.x, next.y) | mask_of(opposite(d)));
 
 			// Carve current cell
-			(*grid)[pos.y][pos.x] = (*grid)[pos.y][pos.x] | mask_of(d);
+			maze_set(maze, pos.x, pos.y, maze_at(maze, pos.x, pos.y) | mask_of(d));
 
-			// Recursive Call
-			backtrack(next, grid);
+			pos = next;
+			stack[top].order = shuffled();
+			stack[top].tried = 0;
+			top++;
 		}
 	}
+
+	gen->pos = pos;
+	gen->top = top;
+	return top == 0;
 }
 
 
-// Initialize a maze
-maze_t* init() {
-	// Allocate maze structure
-	maze_t* maze = (maze_t*) calloc(1, sizeof(maze_t));
-	
-	// Set end position to (7,7)
-	point_t end = {7,7};
-	maze->exit = end;
+// Runs slices until done or out of time
+bool gen_run_for(gen_t* gen, int us) {
+	Timer timer;
+	timer.start();
+	bool done = gen_done(gen);
+	while (!done && timer.read_us() < us) {
+		done = gen_step(gen, GEN_SLICE);
+	}
+	return done;
+}
+
+
+// Done once the stack has unwound
+bool gen_done(const gen_t* gen) {
+	return gen->top == 0;
+}
+
+
+// Releases the stack and visited bits
+void gen_free(gen_t* gen) {
+	free(gen->stack);
+	bitset_free(&gen->visited);
+	gen->maze = NULL;
+	gen->stack = NULL;
+	gen->capacity = 0;
+	gen->top = 0;
+}
+
+
+// Generates a whole maze in one go
+int generate(maze_t* maze) {
+	if (!gen_begin(&scratch, maze)) {
+		return -1;
+	}
+	gen_step(&scratch, (size_t) -1);
+	return 0;
+}
+
+
+// Walk a perfect maze depth first from start to exit. There are no
+// loops, so never turning back the way we came is enough and only
+// a byte per level is kept: the direction we came in by and how
+// many directions have been tried.
+int path_length(const maze_t* maze) {
+	size_t count = (size_t) maze->width * maze->height;
+	uint8_t* stack = (uint8_t*) malloc(count);
+	if (stack == NULL) {
+		return -1;
+	}
+
+	point_t pos = maze->start;
+	size_t depth = 0;
+	stack[0] = NONE << 3;
+
+	while (!points_equal(pos, maze->exit)) {
+		direction came = (direction) (stack[depth] >> 3);
+		int tried = stack[depth] & 7;
+
+		// Dead end, go back the way we came
+		if (tried == 4) {
+			if (depth == 0) {
+				free(stack);
+				return -1;
+			}
+			step(opposite(came), &pos);
+			depth--;
+			continue;
+		}
+
+		direction d = (direction) tried;
+		stack[depth]++;
+		if (d != opposite(came) && can_move(d, maze_at(maze, pos.x, pos.y))) {
+			step(d, &pos);
+			depth++;
+			stack[depth] = d << 3;
+		}
+	}
+
+	free(stack);
+	return (int) depth;
+}
+
+
+// Initialize a maze of a given size
+maze_t* init_maze(int width, int height) {
+	// Allocate maze structure, exit is the far corner
+	maze_t* maze = new_maze(width, height);
+	if (maze == NULL) {
+		return NULL;
+	}
 	
 	// Generate maze paths
-	point_t start = {0, 0};
-	backtrack(start, &(maze->grid));
+	if (generate(maze) != 0) {
+		free_maze(maze);
+		return NULL;
+	}
 
 	return maze;
 }
+
+
+// Initialize a maze of the default size
+maze_t* init() {
+	return init_maze(WIDTH, HEIGHT);
+}
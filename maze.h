@@ -8,6 +8,7 @@
 #define MAZE_H_
 
 #include "mbed.h"
+#include "bitset.h"
 
 
 /*---------------------------------------------------------------
@@ -41,19 +42,53 @@ enum direction {NORTH, SOUTH, EAST, WEST, NONE};
 typedef uint8_t cell;
 
 /**
- * Type of a maze grid.
+ * How the cells of a maze are laid out in memory.
+ *
+ * LAYOUT_ROWS  - row-major, width * height cells.
+ * LAYOUT_TILED - 8x8 tiles of 64 cells (one cache line), tiles in
+ *                row-major order and cells within a tile in Morton
+ *                (Z) order, so vertical neighbours are usually in the
+ *                same line. Dimensions are padded up to whole tiles.
  */
-typedef cell grid_t [8][8];
+enum layout {LAYOUT_ROWS, LAYOUT_TILED};
 
 /**
- * The type of a maze.
+ * The type of a maze. Use maze_at and maze_set rather than
+ * indexing cells, whose order depends on the layout.
  */
 typedef struct {
-	grid_t grid;
+	int width;
+	int height;
+	layout order;
+	int tiles_x;
+	cell* cells;
 	point_t start;
 	point_t exit;
 } maze_t;
 
+/**
+ * One level of the generator's backtracking: the shuffled
+ * directions, two bits each, and how many of them have been tried.
+ */
+typedef struct {
+	uint8_t order;
+	uint8_t tried;
+} gen_frame_t;
+
+/**
+ * A maze generation in progress, which can be run a slice at a time.
+ * Zero-initialise before the first gen_begin; its buffers are kept
+ * between mazes and released by gen_free.
+ */
+typedef struct {
+	maze_t* maze;
+	gen_frame_t* stack;
+	size_t capacity;
+	size_t top;
+	point_t pos;
+	bitset_t visited;
+} gen_t;
+
 
 
 /*---------------------------------------------------------------
@@ -75,10 +110,15 @@ extern int WIDTH;
 cell mask_of(direction dir);
 
 /**
- * Returns string representation of a direction.
+ * Prints the string representation of a direction.
  */
 void print_direction(direction dir);
 
+/**
+ * Returns the string representation of a direction.
+ */
+const char* direction_name(direction dir);
+
 /**
  * Returns the opposite direction from a given direction.
  */
@@ -100,8 +140,118 @@ void step(direction dir, point_t* curr);
 bool points_equal (point_t a, point_t b);
 
 /**
- * Creates a randomly generated maze. Will return the same maze if srand
- * is seeded to the same value.
+ * Returns the position of (x, y) in the maze's cell array.
+ */
+inline size_t maze_index(const maze_t* maze, int x, int y) {
+	if (maze->order == LAYOUT_ROWS) {
+		return (size_t) y * maze->width + x;
+	}
+
+	// Bits of a 3-bit coordinate spread to every other position
+	static const uint8_t spread[8] = {0, 1, 4, 5, 16, 17, 20, 21};
+	size_t tile = (size_t) (y >> 3) * maze->tiles_x + (x >> 3);
+	return (tile << 6) | spread[x & 7] | (spread[y & 7] << 1);
+}
+
+/**
+ * Returns the number of cells allocated for a maze, which for tiled
+ * mazes includes the padding.
+ */
+inline size_t maze_cells(const maze_t* maze) {
+	if (maze->order == LAYOUT_ROWS) {
+		return (size_t) maze->width * maze->height;
+	}
+	return (size_t) maze->tiles_x * ((maze->height + 7) / 8) * 64;
+}
+
+/**
+ * Returns the cell at (x, y), which must be inside the maze.
+ */
+inline cell maze_at(const maze_t* maze, int x, int y) {
+	return maze->cells[maze_index(maze, x, y)];
+}
+
+/**
+ * Overwrites the cell at (x, y), which must be inside the maze.
+ */
+inline void maze_set(maze_t* maze, int x, int y, cell c) {
+	maze->cells[maze_index(maze, x, y)] = c;
+}
+
+/**
+ * Returns 1 if the point lies inside the maze.
+ */
+bool in_bounds(const maze_t* maze, point_t p);
+
+/**
+ * Allocates a row-major maze of the given size with every wall
+ * standing, starting at (0,0) and exiting at the opposite corner.
+ * Returns NULL if out of memory.
+ */
+maze_t* new_maze(int width, int height);
+
+/**
+ * Like new_maze, with the given cell layout.
+ */
+maze_t* new_maze_layout(int width, int height, layout order);
+
+/**
+ * Frees a maze and its cells.
+ */
+void free_maze(maze_t* maze);
+
+/**
+ * Carves paths through a maze from new_maze by backtracking from
+ * its start. Uses rand(), so the result depends on the srand seed.
+ * Returns -1 if out of memory.
+ */
+int generate(maze_t* maze);
+
+/**
+ * Starts generating a maze from new_maze, without carving anything
+ * yet. Returns false if out of memory. The maze is the same as
+ * generate would give as long as nothing else calls rand() until
+ * the generator is done.
+ */
+bool gen_begin(gen_t* gen, maze_t* maze);
+
+/**
+ * Runs a generator for at most the given number of steps, a step
+ * being one direction tried from the current cell. Returns true
+ * once the maze is finished.
+ */
+bool gen_step(gen_t* gen, size_t steps);
+
+/**
+ * Runs a generator for roughly the given number of microseconds.
+ * Returns true once the maze is finished.
+ */
+bool gen_run_for(gen_t* gen, int us);
+
+/**
+ * Returns true if a generator has finished its maze, or has none.
+ */
+bool gen_done(const gen_t* gen);
+
+/**
+ * Releases the buffers of a generator. Does not free its maze.
+ */
+void gen_free(gen_t* gen);
+
+/**
+ * Returns the number of moves on the path from start to exit of a
+ * perfect maze, or -1 if there is none or out of memory.
+ */
+int path_length(const maze_t* maze);
+
+/**
+ * Creates a randomly generated maze of the given size. Will return the
+ * same maze if srand is seeded to the same value.
+ */
+maze_t* init_maze(int width, int height);
+
+/**
+ * Creates a randomly generated WIDTH x HEIGHT maze.
  */
 maze_t* init();
 
@@ -0,0 +1,276 @@
+/*
+ * mazefile.cpp
+ *
+ */
+
+#include "mazefile.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAZEFILE_MMAP 1
+#endif
+
+/*---------------------------------------------------------------
+  Utility functions
+ *---------------------------------------------------------------*/
+
+// Little-endian integer access
+static void put_u16(uint8_t* p, uint16_t v) {
+	p[0] = v & 0xFF;
+	p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+	put_u16(p, v & 0xFFFF);
+	put_u16(p + 2, v >> 16);
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+	return p[0] | (p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+	return get_u16(p) | ((uint32_t) get_u16(p + 2) << 16);
+}
+
+
+// Bytes in one packed row
+static size_t row_size(int width) {
+	return (2 * (size_t) width + 7) / 8;
+}
+
+
+// Fills the fixed header
+static void encode_header(const maze_t* maze, uint8_t* p) {
+	memcpy(p, "IMAZ", 4);
+	put_u16(p + 4, MAZEFILE_VERSION);
+	put_u16(p + 6, 0);
+	put_u32(p + 8, maze->width);
+	put_u32(p + 12, maze->height);
+	put_u32(p + 16, maze->start.x);
+	put_u32(p + 20, maze->start.y);
+	put_u32(p + 24, maze->exit.x);
+	put_u32(p + 28, maze->exit.y);
+}
+
+
+// Packs the east and south walls of one row
+static void encode_row(const maze_t* maze, int y, uint8_t* row) {
+	cell east = mask_of(EAST);
+	cell south = mask_of(SOUTH);
+
+	memset(row, 0, row_size(maze->width));
+	for (int x = 0; x < maze->width; x++) {
+		cell c = maze_at(maze, x, y);
+		uint8_t bits = ((c & east) ? 1 : 0) | ((c & south) ? 2 : 0);
+		row[x >> 2] |= bits << ((x & 3) * 2);
+	}
+}
+
+
+// Two wall bits of a cell, bit 0 east and bit 1 south
+static uint8_t wall_bits(const mazefile_t* file, int x, int y) {
+	uint8_t byte = file->rows[(size_t) y * file->row_bytes + (x >> 2)];
+	return (byte >> ((x & 3) * 2)) & 3;
+}
+
+
+/*---------------------------------------------------------------
+  Maze file functions
+ *---------------------------------------------------------------*/
+
+// Header plus packed rows
+size_t mazefile_size(const maze_t* maze) {
+	return MAZEFILE_HEADER + row_size(maze->width) * maze->height;
+}
+
+
+// Encodes a maze into memory
+size_t mazefile_encode(const maze_t* maze, uint8_t* buf, size_t size) {
+	size_t total = mazefile_size(maze);
+	if (size < total) {
+		return 0;
+	}
+
+	encode_header(maze, buf);
+	uint8_t* row = buf + MAZEFILE_HEADER;
+	for (int y = 0; y < maze->height; y++) {
+		encode_row(maze, y, row);
+		row += row_size(maze->width);
+	}
+
+	return total;
+}
+
+
+// Streams a maze one packed row at a time
+int mazefile_save(const maze_t* maze, FILE* out) {
+	uint8_t header[MAZEFILE_HEADER];
+	size_t len = row_size(maze->width);
+	uint8_t* row = (uint8_t*) malloc(len);
+	if (row == NULL) {
+		return -1;
+	}
+
+	int rtn_val = 0;
+	encode_header(maze, header);
+	if (fwrite(header, 1, MAZEFILE_HEADER, out) != MAZEFILE_HEADER) {
+		rtn_val = -1;
+	}
+
+	for (int y = 0; y < maze->height && rtn_val == 0; y++) {
+		encode_row(maze, y, row);
+		if (fwrite(row, 1, len, out) != len) {
+			rtn_val = -1;
+		}
+	}
+
+	free(row);
+	return rtn_val;
+}
+
+
+// Validates the header and points the view at the rows
+int mazefile_view(mazefile_t* file, const uint8_t* data, size_t size) {
+	memset(file, 0, sizeof(mazefile_t));
+
+	if (size < MAZEFILE_HEADER || memcmp(data, "IMAZ", 4) != 0 ||
+		get_u16(data + 4) != MAZEFILE_VERSION || get_u16(data + 6) != 0)
+	{
+		return -1;
+	}
+
+	uint32_t width = get_u32(data + 8);
+	uint32_t height = get_u32(data + 12);
+	if (width == 0 || height == 0 || width > INT32_MAX || height > INT32_MAX ||
+		(size - MAZEFILE_HEADER) / row_size(width) < height)
+	{
+		return -1;
+	}
+
+	// Start and exit must be cells of the maze
+	uint32_t sx = get_u32(data + 16);
+	uint32_t sy = get_u32(data + 20);
+	uint32_t ex = get_u32(data + 24);
+	uint32_t ey = get_u32(data + 28);
+	if (sx >= width || sy >= height || ex >= width || ey >= height) {
+		return -1;
+	}
+
+	file->width = width;
+	file->height = height;
+	file->row_bytes = row_size(width);
+	file->rows = data + MAZEFILE_HEADER;
+
+	// Nothing may open onto the outside, or a player could walk off
+	// the grid
+	bool sealed = true;
+	for (uint32_t y = 0; sealed && y < height; y++) {
+		sealed = (wall_bits(file, width - 1, y) & 1) == 0;
+	}
+	for (uint32_t x = 0; sealed && x < width; x++) {
+		sealed = (wall_bits(file, x, height - 1) & 2) == 0;
+	}
+	if (!sealed) {
+		memset(file, 0, sizeof(mazefile_t));
+		return -1;
+	}
+
+	file->start.x = sx;
+	file->start.y = sy;
+	file->exit.x = ex;
+	file->exit.y = ey;
+	file->data = data;
+	file->size = size;
+
+	return 0;
+}
+
+
+// Rebuilds the NSEW cell from its own and its neighbours' walls
+cell mazefile_at(const mazefile_t* file, int x, int y) {
+	uint8_t bits = wall_bits(file, x, y);
+	cell c = 0;
+
+	if (bits & 1) {
+		c |= mask_of(EAST);
+	}
+	if (bits & 2) {
+		c |= mask_of(SOUTH);
+	}
+	if (x > 0 && (wall_bits(file, x - 1, y) & 1)) {
+		c |= mask_of(WEST);
+	}
+	if (y > 0 && (wall_bits(file, x, y - 1) & 2)) {
+		c |= mask_of(NORTH);
+	}
+
+	return c;
+}
+
+
+// Copies the view into a maze
+maze_t* mazefile_load(const mazefile_t* file) {
+	maze_t* maze = new_maze(file->width, file->height);
+	if (maze == NULL) {
+		return NULL;
+	}
+
+	maze->start = file->start;
+	maze->exit = file->exit;
+	for (int y = 0; y < file->height; y++) {
+		for (int x = 0; x < file->width; x++) {
+			maze_set(maze, x, y, mazefile_at(file, x, y));
+		}
+	}
+
+	return maze;
+}
+
+
+// Maps a file read-only
+int mazefile_open(mazefile_t* file, const char* path) {
+#ifdef MAZEFILE_MMAP
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return -1;
+	}
+
+	void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return -1;
+	}
+
+	if (mazefile_view(file, (const uint8_t*) map, st.st_size) != 0) {
+		munmap(map, st.st_size);
+		return -1;
+	}
+	file->mapped = true;
+	return 0;
+#else
+	(void) file;
+	(void) path;
+	return -1;
+#endif
+}
+
+
+// Unmaps the file if it was mapped
+void mazefile_close(mazefile_t* file) {
+#ifdef MAZEFILE_MMAP
+	if (file->mapped) {
+		munmap((void*) file->data, file->size);
+	}
+#endif
+	memset(file, 0, sizeof(mazefile_t));
+}
@@ -0,0 +1,112 @@
+/*
+ * mazefile.h
+ *
+ * Compact versioned file format for mazes. Only the east and south
+ * walls of each cell are stored, 2 bits per cell, since the north
+ * and west walls are the neighbours' south and east walls.
+ *
+ * Layout, all integers little-endian:
+ *   0  "IMAZ"
+ *   4  version (u16), flags (u16, reserved, must be 0)
+ *   8  width (u32), height (u32)
+ *   16 start x, y (u32 each)
+ *   24 exit x, y (u32 each)
+ *   32 rows of (2 * width + 7) / 8 bytes. Cell x of a row is bit 2x
+ *      (east open) and bit 2x + 1 (south open), lowest bit first.
+ *
+ * Rows are byte aligned so any cell is found by arithmetic, and a
+ * file can be used in place without being parsed or copied.
+ */
+
+#ifndef MAZEFILE_H_
+#define MAZEFILE_H_
+
+#include "mbed.h"
+#include "maze.h"
+
+
+/*---------------------------------------------------------------
+  Maze file constants
+ *---------------------------------------------------------------*/
+
+#define MAZEFILE_VERSION 1
+#define MAZEFILE_HEADER 32
+
+
+/*---------------------------------------------------------------
+  Maze file types
+ *---------------------------------------------------------------*/
+
+/**
+ * A read-only view of a maze file held in memory or mapped from
+ * disk. Cells are decoded on access.
+ */
+typedef struct {
+	int width;
+	int height;
+	point_t start;
+	point_t exit;
+	size_t row_bytes;
+	const uint8_t* rows;
+
+	// Whole file, and whether it is a mapping owned by the view
+	const uint8_t* data;
+	size_t size;
+	bool mapped;
+} mazefile_t;
+
+
+
+/*---------------------------------------------------------------
+  Maze file functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Returns the size in bytes of the file for a maze.
+ */
+size_t mazefile_size(const maze_t* maze);
+
+/**
+ * Encodes a maze into buf. Returns the number of bytes written, or
+ * 0 if size is smaller than mazefile_size(maze).
+ */
+size_t mazefile_encode(const maze_t* maze, uint8_t* buf, size_t size);
+
+/**
+ * Writes a maze to a stream one row at a time.
+ * Returns 0 on success, -1 on error.
+ */
+int mazefile_save(const maze_t* maze, FILE* out);
+
+/**
+ * Sets up a view of an encoded maze in memory, which must outlive
+ * the view. Returns 0 on success, -1 if the data is not a valid
+ * maze file, including a start or exit outside the maze or a
+ * passage through the outer wall.
+ */
+int mazefile_view(mazefile_t* file, const uint8_t* data, size_t size);
+
+/**
+ * Returns the cell at (x, y) with all four sides decoded, for use
+ * with can_move. (x, y) must be inside the maze.
+ */
+cell mazefile_at(const mazefile_t* file, int x, int y);
+
+/**
+ * Copies a maze file into a newly allocated maze.
+ * Returns NULL if out of memory.
+ */
+maze_t* mazefile_load(const mazefile_t* file);
+
+/**
+ * Maps a maze file from disk and sets up a view of it. Only
+ * available on POSIX hosts. Returns 0 on success, -1 on error.
+ */
+int mazefile_open(mazefile_t* file, const char* path);
+
+/**
+ * Releases a view, unmapping the file if mazefile_open mapped it.
+ */
+void mazefile_close(mazefile_t* file);
+
+#endif /* MAZEFILE_H_ */
@@ -0,0 +1,109 @@
+/*
+ * output.cpp
+ *
+ */
+
+#include "output.h"
+
+/*---------------------------------------------------------------
+  Transmit queue
+ *---------------------------------------------------------------*/
+
+// Queue size, must be a power of two
+#define OUTPUT_SIZE 2048
+
+// Single-producer/single-consumer ring buffer. The game loop is the
+// only writer of head and the TX interrupt the only writer of tail.
+// The bytes are volatile too, so their stores cannot be moved after
+// the head update that hands them to the interrupt.
+static volatile char queue[OUTPUT_SIZE];
+static volatile uint head = 0;
+static volatile uint tail = 0;
+static volatile uint dropped = 0;
+
+// True while the TX interrupt is enabled
+static volatile bool sending = false;
+
+static RawSerial* output_serial;
+
+
+// TX interrupt: keep the UART fed until the queue is empty
+static void on_transmit() {
+	while (tail != head && output_serial->writeable()) {
+		output_serial->putc(queue[tail & (OUTPUT_SIZE - 1)]);
+		tail = tail + 1;
+	}
+
+	if (tail == head) {
+		sending = false;
+		output_serial->attach(Callback<void()>(), SerialBase::TxIrq);
+	}
+}
+
+
+/*---------------------------------------------------------------
+  Output functions
+ *---------------------------------------------------------------*/
+
+// Remembers the port
+void init_output(RawSerial* serial) {
+	output_serial = serial;
+}
+
+
+// Copies into the queue and makes sure the interrupt is running
+size_t out_write(const void* data, size_t len) {
+	const char* bytes = (const char*) data;
+
+	if (len > OUTPUT_SIZE - (head - tail)) {
+		dropped = dropped + 1;
+		return 0;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		queue[(head + i) & (OUTPUT_SIZE - 1)] = bytes[i];
+	}
+	head = head + len;
+
+	// The interrupt turns itself off when it empties the queue, so
+	// check and restart it atomically
+	core_util_critical_section_enter();
+	if (!sending) {
+		sending = true;
+		output_serial->attach(&on_transmit, SerialBase::TxIrq);
+	}
+	core_util_critical_section_exit();
+
+	return len;
+}
+
+
+// Formats into a line buffer, then queues it
+int out_printf(const char* fmt, ...) {
+	char line[OUTPUT_LINE];
+	va_list args;
+	va_start(args, fmt);
+	int len = vsnprintf(line, sizeof(line), fmt, args);
+	va_end(args);
+
+	if (len < 0) {
+		return 0;
+	} else if (len >= OUTPUT_LINE) {
+		len = OUTPUT_LINE - 1;
+	}
+	return out_write(line, len);
+}
+
+
+// Waits for the queue to empty
+void out_flush() {
+	while (tail != head) {
+		sleep();
+	}
+}
+
+
+// Writes lost to a full queue
+uint dropped_output() {
+	return dropped;
+}
@@ -0,0 +1,56 @@
+/*
+ * output.h
+ *
+ * Non-blocking console output. Text is queued in a ring buffer and
+ * sent from the serial TX interrupt, so callers never wait on the
+ * UART.
+ */
+
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include "mbed.h"
+
+
+/*---------------------------------------------------------------
+  Output functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Sets the serial port output is sent on. Must be called before any
+ * other output function.
+ */
+void init_output(RawSerial* serial);
+
+/**
+ * Queues len bytes for sending. A write that does not fit in the
+ * free space is dropped whole and counted, never split or waited
+ * for. Returns len if queued, 0 if dropped.
+ */
+size_t out_write(const void* data, size_t len);
+
+/**
+ * Formats like printf and queues the result with out_write.
+ * Output longer than OUTPUT_LINE bytes is truncated.
+ * Returns the number of bytes queued.
+ */
+int out_printf(const char* fmt, ...);
+
+/**
+ * Sleeps until everything queued has been handed to the UART.
+ */
+void out_flush();
+
+/**
+ * Returns the number of writes dropped because the queue was full.
+ */
+uint dropped_output();
+
+
+/*---------------------------------------------------------------
+  Output constants
+ *---------------------------------------------------------------*/
+
+#define OUTPUT_LINE 160
+
+#endif /* OUTPUT_H_ */
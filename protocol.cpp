@@ -0,0 +1,130 @@
+/*
+ * protocol.cpp
+ *
+ */
+
+#include "protocol.h"
+
+/*---------------------------------------------------------------
+  Decoder states
+ *---------------------------------------------------------------*/
+
+#define WAIT_SYNC 0
+#define WAIT_LEN 1
+#define WAIT_PAYLOAD 2
+#define WAIT_CRC 3
+
+
+// Drops any partial frame
+static void restart(proto_parser_t* parser) {
+	parser->state = WAIT_SYNC;
+	parser->len = 0;
+	parser->count = 0;
+	parser->crc = 0;
+}
+
+
+/*---------------------------------------------------------------
+  Protocol functions
+ *---------------------------------------------------------------*/
+
+// Bitwise CRC-8, frames are only a few bytes long
+uint8_t proto_crc(uint8_t crc, const uint8_t* data, size_t len) {
+	for (size_t i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc & 0x80) ? (uint8_t) ((crc << 1) ^ 0x07) : (uint8_t) (crc << 1);
+		}
+	}
+	return crc;
+}
+
+
+// Builds a frame around a payload
+size_t proto_encode(const uint8_t* payload, size_t len, uint8_t* out) {
+	if (len == 0 || len > PROTO_MAX_PAYLOAD) {
+		return 0;
+	}
+
+	out[0] = PROTO_SYNC;
+	out[1] = (uint8_t) len;
+	for (size_t i = 0; i < len; i++) {
+		out[2 + i] = payload[i];
+	}
+	out[2 + len] = proto_crc(0, &out[1], len + 1);
+
+	return len + 3;
+}
+
+
+// Waits for a new frame and clears the error count
+void proto_reset(proto_parser_t* parser) {
+	restart(parser);
+	parser->errors = 0;
+}
+
+
+// Advances the decoder by one byte
+int proto_feed(proto_parser_t* parser, uint8_t byte) {
+	switch (parser->state) {
+	case WAIT_SYNC:
+		if (byte == PROTO_SYNC) {
+			parser->state = WAIT_LEN;
+		}
+		return 0;
+
+	case WAIT_LEN:
+		if (byte == 0 || byte > PROTO_MAX_PAYLOAD) {
+			parser->errors++;
+			restart(parser);
+			return -1;
+		}
+		parser->len = byte;
+		parser->count = 0;
+		parser->crc = proto_crc(0, &byte, 1);
+		parser->state = WAIT_PAYLOAD;
+		return 0;
+
+	case WAIT_PAYLOAD:
+		parser->payload[parser->count++] = byte;
+		parser->crc = proto_crc(parser->crc, &byte, 1);
+		if (parser->count == parser->len) {
+			parser->state = WAIT_CRC;
+		}
+		return 0;
+
+	default:
+		parser->state = WAIT_SYNC;
+		if (byte != parser->crc) {
+			parser->errors++;
+			return -1;
+		}
+		return 1;
+	}
+}
+
+
+// Little-endian status payload
+void proto_pack_status(const proto_status_t* status, uint8_t* payload) {
+	payload[0] = status->flags;
+	payload[1] = status->x & 0xFF;
+	payload[2] = status->x >> 8;
+	payload[3] = status->y & 0xFF;
+	payload[4] = status->y >> 8;
+	payload[5] = status->turns & 0xFF;
+	payload[6] = status->turns >> 8;
+}
+
+
+// Reads a status payload
+int proto_unpack_status(const uint8_t* payload, size_t len, proto_status_t* status) {
+	if (len != PROTO_STATUS_SIZE) {
+		return -1;
+	}
+
+	status->flags = payload[0];
+	status->x = payload[1] | (payload[2] << 8);
+	status->y = payload[3] | (payload[4] << 8);
+	status->turns = payload[5] | (payload[6] << 8);
+	return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * protocol.h
+ *
+ * Compact framed binary protocol for driving the game from another
+ * program. Shared by the board and the host client, so it only
+ * depends on the C library.
+ *
+ * Frame:    SYNC | LEN | PAYLOAD (LEN bytes) | CRC-8 of LEN and PAYLOAD
+ * Requests: 'w', 'a', 's' or 'd'         one move
+ *           PROTO_START seed (int32 LE)  new maze from seed
+ * Response: flags x (u16 LE) y (u16 LE) turns (u16 LE)
+ *
+ * Once a maze is won, moves are refused with BLOCKED (and WON) until
+ * the next PROTO_START. A START the board has no memory for is
+ * answered with ERROR, and moves are errors until a START succeeds.
+ */
+
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/*---------------------------------------------------------------
+  Protocol constants
+ *---------------------------------------------------------------*/
+
+#define PROTO_SYNC 0xA5
+#define PROTO_START 0x01
+#define PROTO_MAX_PAYLOAD 16
+#define PROTO_MAX_FRAME (PROTO_MAX_PAYLOAD + 3)
+#define PROTO_STATUS_SIZE 7
+
+// Response flags
+#define PROTO_BLOCKED 0x01
+#define PROTO_WON 0x02
+#define PROTO_INVALID 0x04
+#define PROTO_ERROR 0x08
+
+
+/*---------------------------------------------------------------
+  Protocol types
+ *---------------------------------------------------------------*/
+
+/**
+ * Decoded response to a request.
+ */
+typedef struct {
+	uint8_t flags;
+	uint16_t x;
+	uint16_t y;
+	uint16_t turns;
+} proto_status_t;
+
+/**
+ * Incremental frame decoder state.
+ */
+typedef struct {
+	uint8_t state;
+	uint8_t len;
+	uint8_t count;
+	uint8_t crc;
+	uint8_t payload[PROTO_MAX_PAYLOAD];
+	uint32_t errors;
+} proto_parser_t;
+
+
+
+/*---------------------------------------------------------------
+  Protocol functions
+ *---------------------------------------------------------------*/
+
+/**
+ * CRC-8 (polynomial 0x07) of a buffer, continuing from crc.
+ */
+uint8_t proto_crc(uint8_t crc, const uint8_t* data, size_t len);
+
+/**
+ * Wraps a payload in a frame. out must hold len + 3 bytes.
+ * Returns the frame length, or 0 if the payload is too long.
+ */
+size_t proto_encode(const uint8_t* payload, size_t len, uint8_t* out);
+
+/**
+ * Resets a decoder to wait for the next frame and clears its count
+ * of dropped frames.
+ */
+void proto_reset(proto_parser_t* parser);
+
+/**
+ * Feeds one received byte to the decoder. Returns 1 when a frame
+ * with a valid CRC is complete (payload and len hold it), -1 when a
+ * frame was dropped for a bad CRC or length, and 0 otherwise.
+ */
+int proto_feed(proto_parser_t* parser, uint8_t byte);
+
+/**
+ * Packs a status into PROTO_STATUS_SIZE bytes of payload.
+ */
+void proto_pack_status(const proto_status_t* status, uint8_t* payload);
+
+/**
+ * Unpacks a status payload. Returns 0 on success, -1 if len is wrong.
+ */
+int proto_unpack_status(const uint8_t* payload, size_t len, proto_status_t* status);
+
+#endif /* PROTOCOL_H_ */
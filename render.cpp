@@ -0,0 +1,105 @@
+/*
+ * render.cpp
+ *
+ */
+
+#include "render.h"
+
+/*---------------------------------------------------------------
+  Glyph table
+ *---------------------------------------------------------------*/
+
+// Two characters drawn for each cell, indexed by its NSEW bits.
+// The first is the floor (south wall), the second the east wall.
+// An open east side is drawn as floor unless the cell or its east
+// neighbour is open to the south, which render_row patches in.
+static const char glyphs[16][2] = {
+	{'_', '|'}, {'_', '|'}, {'_', '_'}, {'_', '_'},	// ----, ---W, --E-, --EW
+	{' ', '|'}, {' ', '|'}, {' ', ' '}, {' ', ' '},	// -S--, -S-W, -SE-, -SEW
+	{'_', '|'}, {'_', '|'}, {'_', '_'}, {'_', '_'},	// N---, N--W, N-E-, N-EW
+	{' ', '|'}, {' ', '|'}, {' ', ' '}, {' ', ' '},	// NS--, NS-W, NSE-, NSEW
+};
+
+
+/*---------------------------------------------------------------
+  Render functions
+ *---------------------------------------------------------------*/
+
+// Top border and each row are 2 * width + 1 characters plus newline
+size_t render_size(const maze_t* maze) {
+	return (size_t) (maze->height + 1) * (2 * maze->width + 2) + 1;
+}
+
+
+// Renders a single row of cells
+size_t render_row(const maze_t* maze, int y, char* buf) {
+	cell south = mask_of(SOUTH);
+	char* p = buf;
+
+	*p++ = '|';
+	for (int x = 0; x < maze->width; x++) {
+		const char* g = glyphs[maze_at(maze, x, y) & 0xF];
+		*p++ = g[0];
+		if (g[1] == '_' && x < maze->width - 1 && (maze_at(maze, x + 1, y) & south)) {
+			*p++ = ' ';
+		} else {
+			*p++ = g[1];
+		}
+	}
+	*p++ = '\n';
+
+	return p - buf;
+}
+
+
+// Renders the whole maze into a buffer
+size_t render_maze(const maze_t* maze, char* buf, size_t size) {
+	if (size < render_size(maze)) {
+		return 0;
+	}
+
+	// Top of maze
+	char* p = buf;
+	*p++ = ' ';
+	memset(p, '_', 2 * maze->width - 1);
+	p += 2 * maze->width - 1;
+	*p++ = '\n';
+
+	for (int y = 0; y < maze->height; y++) {
+		p += render_row(maze, y, p);
+	}
+	*p = '\0';
+
+	return p - buf;
+}
+
+
+// Streams the maze row by row
+int render_to(const maze_t* maze, FILE* out) {
+	size_t line_size = 2 * maze->width + 2;
+	char* line = (char*) malloc(line_size);
+	if (line == NULL) {
+		return -1;
+	}
+
+	int rtn_val = 0;
+
+	// Top of maze, one character shorter than a row
+	size_t top_size = line_size - 1;
+	line[0] = ' ';
+	memset(&line[1], '_', 2 * maze->width - 1);
+	line[top_size - 1] = '\n';
+	if (fwrite(line, 1, top_size, out) != top_size) {
+		rtn_val = -1;
+	}
+
+	for (int y = 0; y < maze->height && rtn_val == 0; y++) {
+		size_t n = render_row(maze, y, line);
+		if (fwrite(line, 1, n, out) != n) {
+			rtn_val = -1;
+		}
+	}
+
+	free(line);
+	return rtn_val;
+}
@@ -0,0 +1,44 @@
+/*
+ * render.h
+ *
+ * ASCII rendering of mazes into memory buffers and streams.
+ */
+
+#ifndef RENDER_H_
+#define RENDER_H_
+
+#include "mbed.h"
+#include "maze.h"
+
+
+/*---------------------------------------------------------------
+  Render functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Returns the number of bytes render_maze writes for a maze,
+ * including the terminating NUL.
+ */
+size_t render_size(const maze_t* maze);
+
+/**
+ * Renders a maze as ASCII art into buf. Returns the number of
+ * characters written, not counting the terminating NUL, or 0 if
+ * size is smaller than render_size(maze).
+ */
+size_t render_maze(const maze_t* maze, char* buf, size_t size);
+
+/**
+ * Renders one row of the maze (without the top border) into buf,
+ * which must hold at least 2 * width + 2 bytes. Returns the number
+ * of characters written; the row is not NUL terminated.
+ */
+size_t render_row(const maze_t* maze, int y, char* buf);
+
+/**
+ * Renders a maze to a stream one row at a time, so memory use only
+ * depends on the maze width. Returns 0 on success, -1 on error.
+ */
+int render_to(const maze_t* maze, FILE* out);
+
+#endif /* RENDER_H_ */
@@ -0,0 +1,80 @@
+/*
+ * session.cpp
+ *
+ */
+
+#include "session.h"
+
+/*---------------------------------------------------------------
+  Utility functions
+ *---------------------------------------------------------------*/
+
+// Status frame for the session's game, or for no game if it has none
+static size_t status_frame(const state_t* state, uint8_t flags, uint8_t* out) {
+	proto_status_t status;
+	status.flags = flags;
+	status.x = 0;
+	status.y = 0;
+	status.turns = 0;
+	if (state != NULL) {
+		status.x = state->curr_pos.x;
+		status.y = state->curr_pos.y;
+		status.turns = state->turns;
+		if (state->game_complete) {
+			status.flags |= PROTO_WON;
+		}
+	}
+
+	uint8_t payload[PROTO_STATUS_SIZE];
+	proto_pack_status(&status, payload);
+	return proto_encode(payload, PROTO_STATUS_SIZE, out);
+}
+
+
+/*---------------------------------------------------------------
+  Session functions
+ *---------------------------------------------------------------*/
+
+// No game yet
+void session_init(session_t* session) {
+	session->state = NULL;
+	session->seed = 0;
+}
+
+
+// Frees the game
+void session_free(session_t* session) {
+	free_state(session->state);
+	session->state = NULL;
+}
+
+
+// Every request is answered with exactly one status frame
+size_t session_answer(session_t* session, const uint8_t* payload, size_t len, uint8_t* out) {
+	state_t* state = session->state;
+
+	if (len == 5 && payload[0] == PROTO_START) {
+		// New maze from a seed
+		session_free(session);
+		session->seed = payload[1] | (payload[2] << 8) |
+			(payload[3] << 16) | ((uint32_t) payload[4] << 24);
+		srand(session->seed);
+		session->state = init_state();
+		return status_frame(session->state, session->state == NULL ? PROTO_ERROR : 0, out);
+	}
+
+	if (state == NULL || len != 1) {
+		return status_frame(state, PROTO_ERROR, out);
+	}
+	if (state->game_complete) {
+		// The round is over, nothing moves until a new maze
+		return status_frame(state, PROTO_BLOCKED, out);
+	}
+
+	// One move
+	switch (apply_input(payload[0], state)) {
+	case MOVE_INVALID: return status_frame(state, PROTO_INVALID, out);
+	case MOVE_BLOCKED: return status_frame(state, PROTO_BLOCKED, out);
+	default: 		   return status_frame(state, 0, out);
+	}
+}
@@ -0,0 +1,55 @@
+/*
+ * session.h
+ *
+ * One game driven through the binary protocol. Turns a request
+ * payload into the status frame that answers it, so the board's
+ * binary mode, the host server and the tests all answer requests
+ * with the same code.
+ */
+
+#ifndef SESSION_H_
+#define SESSION_H_
+
+#include "mbed.h"
+#include "game.h"
+#include "protocol.h"
+
+
+/*---------------------------------------------------------------
+  Session types
+ *---------------------------------------------------------------*/
+
+/**
+ * Type of a protocol session: its game, if one was started, and the
+ * seed that game was generated from.
+ */
+typedef struct {
+	state_t* state;
+	int32_t seed;
+} session_t;
+
+
+
+/*---------------------------------------------------------------
+  Session functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Starts a session with no game.
+ */
+void session_init(session_t* session);
+
+/**
+ * Frees the session's game, if any.
+ */
+void session_free(session_t* session);
+
+/**
+ * Answers one request payload, starting a game or applying a move
+ * to it, and writes the status frame to out, which must hold
+ * PROTO_MAX_FRAME bytes.
+ * Returns the frame length.
+ */
+size_t session_answer(session_t* session, const uint8_t* payload, size_t len, uint8_t* out);
+
+#endif /* SESSION_H_ */
@@ -0,0 +1,138 @@
+/*
+ * show.cpp
+ *
+ */
+
+#include "show.h"
+#include "viewport.h"
+#include "animation.h"
+#include "gray.h"
+#include "bitset.h"
+#include "term.h"
+
+/*---------------------------------------------------------------
+  Display state
+ *---------------------------------------------------------------*/
+
+// Where the maze is drawn, and the devices across and down the chain
+static framebuffer_t* show_fb;
+static int show_cols = 1;
+static int show_rows = 1;
+
+// Window of the maze shown on the LED chain, following the player
+static viewport_t view;
+static point_t player;
+
+// Cells the player has visited, shown dimly. Off for unbounded
+// worlds, or if there was no memory for it.
+static bitset_t trail;
+static bool trail_on = false;
+
+
+/*---------------------------------------------------------------
+  LED display
+ *---------------------------------------------------------------*/
+
+// The player is brightest and the cells already visited are dimly
+// lit; the rest of the maze stays invisible. Visits are only kept
+// for bounded mazes.
+static int show_player(void* ctx, int x, int y) {
+	if (x == player.x && y == player.y) {
+		return GRAY_MAX;
+	}
+	if (trail_on && 0 <= x && x < view.width && 0 <= y && y < view.height &&
+		bitset_get(&trail, (size_t) y * view.width + x))
+	{
+		return 1;
+	}
+	return 0;
+}
+
+
+// Remembers the chain
+void show_init(framebuffer_t* fb, int cols, int rows) {
+	show_fb = fb;
+	show_cols = cols;
+	show_rows = rows;
+}
+
+
+// Starts showing a plane of the given size, 0 if unbounded
+void show_start(int width, int height, point_t pos) {
+	gray_stop();
+	anim_stop();
+	gray_clear();
+
+	player = pos;
+	view_init(&view, show_fb, show_cols, show_rows, width, height, &show_player, NULL);
+	view_planes(&view, gray_planes(), GRAY_PLANES);
+	trail_on = width > 0 && height > 0 && bitset_reset(&trail, (size_t) width * height);
+
+	view_follow(&view, pos);
+	view_redraw(&view);
+	gray_start(show_fb);
+}
+
+
+// Stops showing levels, so the framebuffer can be used directly
+void show_stop() {
+	gray_stop();
+	fb_clear(show_fb);
+	fb_flush(show_fb);
+}
+
+
+// Moves the player's LED, leaving a trail and scrolling to keep it
+// in sight. The grayscale cycle sends the change.
+void show_position(point_t pos) {
+	point_t old = player;
+	player = pos;
+	if (trail_on) {
+		bitset_set(&trail, (size_t) old.y * view.width + old.x);
+	}
+	view_update(&view, old.x, old.y);
+	view_update(&view, pos.x, pos.y);
+	view_follow(&view, pos);
+}
+
+
+/*---------------------------------------------------------------
+  Terminal display
+ *---------------------------------------------------------------*/
+
+// Status rows and prompt before a key, then the LED
+void show_turn(const state_t* state) {
+	point_t pos = state->curr_pos;
+	term_line(ROW_POSITION, "You're currently at position %d, %d", pos.y, pos.x);
+	term_line(ROW_TURNS, "Turns: %d", state->turns);
+	term_line(ROW_PROMPT, "Input a direction: ");
+	term_cursor(ROW_PROMPT, 19);
+	term_flush();
+
+	show_position(pos);
+}
+
+
+// Message for a key that did not move the player, blank otherwise
+void show_result(char key, move_result result) {
+	if (result == MOVE_INVALID) {
+		term_line(ROW_MESSAGE, "Try a valid direction (use WASD)");
+	} else if (result == MOVE_BLOCKED) {
+		term_line(ROW_MESSAGE, "You can't go %s here!", direction_name(interpret(key)));
+	} else {
+		term_line(ROW_MESSAGE, "");
+	}
+}
+
+
+// One key of play(), without waiting for it
+void show_move(state_t* state, char key, move_result result) {
+	if (key == 0) {
+		term_begin();
+		term_clear(0, TERM_ROWS);
+		show_start(state->maze->width, state->maze->height, state->curr_pos);
+	} else {
+		show_result(key, result);
+	}
+	show_turn(state);
+}
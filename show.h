@@ -0,0 +1,75 @@
+/*
+ * show.h
+ *
+ * What the player sees while a round is played: the player's LED
+ * and trail on the matrix chain, and the status rows and prompt on
+ * the terminal. Shared by play() and the bot harness, so bots load
+ * the same drawing path a person does.
+ */
+
+#ifndef SHOW_H_
+#define SHOW_H_
+
+#include "mbed.h"
+#include "framebuffer.h"
+#include "game.h"
+
+
+/*---------------------------------------------------------------
+  Show constants
+ *---------------------------------------------------------------*/
+
+// Screen rows used by the game
+#define ROW_POSITION 0
+#define ROW_TURNS 1
+#define ROW_MESSAGE 2
+#define ROW_PROMPT 3
+#define ROW_MAZE 5
+
+
+/*---------------------------------------------------------------
+  Show functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Sets the framebuffer the maze is shown on, and how many devices
+ * across and down the chain it spans.
+ */
+void show_init(framebuffer_t* fb, int cols, int rows);
+
+/**
+ * Starts showing a plane of the given size, 0 if unbounded, with
+ * the player at pos.
+ */
+void show_start(int width, int height, point_t pos);
+
+/**
+ * Stops showing levels, so the framebuffer can be used directly.
+ */
+void show_stop();
+
+/**
+ * Moves the player's LED, leaving a trail and scrolling to keep it
+ * in sight. The grayscale cycle sends the change.
+ */
+void show_position(point_t pos);
+
+/**
+ * Draws the position, turn count and prompt, sends the changes to
+ * the terminal and moves the player's LED.
+ */
+void show_turn(const state_t* state);
+
+/**
+ * Sets the message row for the result of a key.
+ */
+void show_result(char key, move_result result);
+
+/**
+ * Shows a key's result and the next prompt, as play() does after
+ * each key. Key 0 starts a round on the state instead. Fits the
+ * bot harness's show hook.
+ */
+void show_move(state_t* state, char key, move_result result);
+
+#endif /* SHOW_H_ */
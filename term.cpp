@@ -0,0 +1,176 @@
+/*
+ * term.cpp
+ *
+ */
+
+#include "term.h"
+#include "render.h"
+#include "output.h"
+
+/*---------------------------------------------------------------
+  Screen state
+ *---------------------------------------------------------------*/
+
+// Unchanged runs shorter than this are resent rather than skipped,
+// since a cursor escape costs about as much
+#define TERM_GAP 6
+
+// Longest cursor escape, "ESC[rr;ccH"
+#define TERM_ESC 8
+
+// A row of cells changing in runs split by the widest skipped gaps
+#define TERM_OUT_SIZE (TERM_COLS + (TERM_COLS / (TERM_GAP + 1) + 1) * TERM_ESC)
+
+// What the terminal shows and what it should show
+static char shown[TERM_ROWS][TERM_COLS];
+static char wanted[TERM_ROWS][TERM_COLS];
+static bool active = false;
+
+static int cursor_row = 0;
+static int cursor_col = 0;
+
+static char out[TERM_OUT_SIZE];
+
+
+/*---------------------------------------------------------------
+  Terminal functions
+ *---------------------------------------------------------------*/
+
+// Clears the screen if it is not already tracked
+void term_begin() {
+	if (active) {
+		return;
+	}
+
+	memset(shown, ' ', sizeof(shown));
+	memset(wanted, ' ', sizeof(wanted));
+	cursor_row = 0;
+	cursor_col = 0;
+	active = true;
+
+	// Clear screen, set cursor to home. If that cannot be queued,
+	// mark every cell unknown so the first flush overwrites them all.
+	if (out_write("\033[2J\033[H", 7) == 0) {
+		memset(shown, 0, sizeof(shown));
+	}
+}
+
+
+// Returns the screen to scrolling output below the drawn rows
+void term_end() {
+	int last = 0;
+	for (int row = 0; row < TERM_ROWS; row++) {
+		for (int col = 0; col < TERM_COLS; col++) {
+			if (wanted[row][col] != ' ') {
+				last = row + 1;
+				break;
+			}
+		}
+	}
+
+	term_cursor(last < TERM_ROWS ? last : TERM_ROWS - 1, 0);
+	term_flush();
+	active = false;
+}
+
+
+// Formats a row of text
+void term_line(int row, const char* fmt, ...) {
+	if (row < 0 || row >= TERM_ROWS) {
+		return;
+	}
+
+	char text[TERM_COLS + 1];
+	va_list args;
+	va_start(args, fmt);
+	int len = vsnprintf(text, sizeof(text), fmt, args);
+	va_end(args);
+
+	if (len < 0) {
+		len = 0;
+	} else if (len > TERM_COLS) {
+		len = TERM_COLS;
+	}
+	memcpy(wanted[row], text, len);
+	memset(&wanted[row][len], ' ', TERM_COLS - len);
+}
+
+
+// Draws the maze one text line per row
+void term_maze(int row, const maze_t* maze) {
+	size_t size = render_size(maze);
+	char* frame = (char*) malloc(size);
+	if (frame == NULL) {
+		return;
+	}
+	render_maze(maze, frame, size);
+
+	char* line = frame;
+	while (*line != '\0' && row < TERM_ROWS) {
+		char* end = strchr(line, '\n');
+		int len = end - line;
+		term_line(row, "%.*s", len, line);
+		line = end + 1;
+		row++;
+	}
+
+	free(frame);
+}
+
+
+// Blanks a range of rows
+void term_clear(int first, int last) {
+	for (int row = first; row < last && row < TERM_ROWS; row++) {
+		if (row >= 0) {
+			memset(wanted[row], ' ', TERM_COLS);
+		}
+	}
+}
+
+
+// Places the cursor after the next flush
+void term_cursor(int row, int col) {
+	cursor_row = row;
+	cursor_col = col;
+}
+
+
+// Sends the difference between wanted and shown. Each row is queued
+// as one write and only marked as shown if it was not dropped, so a
+// full output queue just delays the row to a later flush.
+size_t term_flush() {
+	size_t total = 0;
+
+	for (int row = 0; row < TERM_ROWS; row++) {
+		size_t n = 0;
+		int col = 0;
+		while (col < TERM_COLS) {
+			// Find the next changed run, absorbing short unchanged gaps
+			if (wanted[row][col] == shown[row][col]) {
+				col++;
+				continue;
+			}
+			int start = col;
+			int end = col + 1;
+			for (int i = end; i < TERM_COLS && i < end + TERM_GAP; i++) {
+				if (wanted[row][i] != shown[row][i]) {
+					end = i + 1;
+				}
+			}
+
+			n += sprintf(&out[n], "\033[%d;%dH", row + 1, start + 1);
+			memcpy(&out[n], &wanted[row][start], end - start);
+			n += end - start;
+			col = end;
+		}
+
+		if (n > 0 && out_write(out, n) == n) {
+			memcpy(shown[row], wanted[row], TERM_COLS);
+			total += n;
+		}
+	}
+
+	size_t n = sprintf(out, "\033[%d;%dH", cursor_row + 1, cursor_col + 1);
+	total += out_write(out, n);
+	return total;
+}
@@ -0,0 +1,67 @@
+/*
+ * term.h
+ *
+ * Incremental ANSI terminal output. Keeps a shadow copy of what is
+ * on screen and only sends the characters that changed, using
+ * cursor addressing escapes.
+ */
+
+#ifndef TERM_H_
+#define TERM_H_
+
+#include "mbed.h"
+#include "maze.h"
+
+
+/*---------------------------------------------------------------
+  Terminal constants
+ *---------------------------------------------------------------*/
+
+#define TERM_ROWS 24
+#define TERM_COLS 80
+
+
+/*---------------------------------------------------------------
+  Terminal functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Takes over the screen. Clears it once if the shadow copy is not
+ * known to match the terminal, otherwise does nothing.
+ */
+void term_begin();
+
+/**
+ * Sends any pending changes, moves the cursor below the last
+ * non-blank row and hands the screen back to scrolling output.
+ */
+void term_end();
+
+/**
+ * Sets a whole row to formatted text, padding it with spaces.
+ */
+void term_line(int row, const char* fmt, ...);
+
+/**
+ * Draws the maze as ASCII art starting at the given row, clipped to
+ * the screen.
+ */
+void term_maze(int row, const maze_t* maze);
+
+/**
+ * Blanks rows first up to but not including last.
+ */
+void term_clear(int first, int last);
+
+/**
+ * Sets where the cursor is left after the next flush.
+ */
+void term_cursor(int row, int col);
+
+/**
+ * Queues the characters that differ from the screen, one write per
+ * changed row. Returns the number of bytes queued.
+ */
+size_t term_flush();
+
+#endif /* TERM_H_ */
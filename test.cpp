@@ -7,38 +7,309 @@
 
 /* Test cases */
 
-// A simple test for the LED matrix
+// A simple test for the LED matrix, played by the animation engine
 // Requires that MATRIX device is initialized and enabled.
 bool test_led() {
-	printf("Starting LED test\n");
+	out_printf("Starting LED test\n");
 
-	// Flash all LEDs for 1 second
-	mat.device_all_off(MATRIX);
+	// Flash all LEDs for 1 second, disable for 1 second, then flash
+	// each individual LED once
+	anim_blink(1, ANIM_FPS);
+	anim_sweep();
 
-	mat.device_all_on(MATRIX);
-	wait(1);
+	while (anim_busy()) {
+		if (!anim_poll()) {
+			sleep();
+		}
+	}
 
-	// Disable for 1 second
-	mat.device_all_off(MATRIX);
-	wait(1);
+	out_printf("Passed LED test\n");
+	return true;
+}
 
-	// Flash each individual LED once
-	for (int row = 0; row < 8; row++) {
-		for (int col = 0; col < 8; col++) {
-			mat.write_digit(1, row + 1, 1 << col);
-			wait(0.05);
+
+// Tests that queued animations play one frame per tick, in order,
+// and leave the display blank
+bool test_animation() {
+	out_printf("Starting animation test\n");
+	bool ok = anim_scroll("HI!") && anim_blink(2, 3) && anim_sweep() && anim_sweep();
+	ok = ok && !anim_blink(1, 1);
+
+	int frames = 0;
+	bool lit = false;
+	while (ok && anim_busy()) {
+		if (anim_poll()) {
+			frames++;
+			lit = lit || fb.wanted[0][0] || fb.wanted[0][3];
+		} else {
+			sleep();
 		}
-		mat.clear_digit(MATRIX, row + 1);
 	}
 
-	printf("Passed LED test\n");
+	// Scroll covers the strip and 3 glyphs, blink 4 phases of 3,
+	// then two sweeps and the final blank frame
+	ok = ok && lit && frames == (8 + 3 * 4) + 2 * 2 * 3 + 64 + 64 + 1 &&
+		fb.shown[0][0] == 0 && fb.shown[0][3] == 0;
+
+	if (!ok) {
+		out_printf("Failed animation test\n");
+		return false;
+	}
+	out_printf("Passed animation test\n");
+	return true;
+}
+
+
+// Tests that flushing only sends the rows that changed
+bool test_framebuffer() {
+	out_printf("Starting framebuffer test\n");
+	framebuffer_t local;
+	fb_init(&local, &mat, MATRIX);
+
+	// Unknown contents, so every row goes out
+	bool ok = fb_flush(&local) == 8;
+
+	// Light one LED, then move it like a player would
+	fb_set(&local, MATRIX, 2, 3, true);
+	ok = ok && fb_flush(&local) == 1;
+	fb_clear(&local);
+	fb_set(&local, MATRIX, 4, 3, true);
+	ok = ok && fb_flush(&local) == 2;
+	fb_clear(&local);
+	fb_set(&local, MATRIX, 4, 5, true);
+	ok = ok && fb_flush(&local) == 1;
+	ok = ok && fb_flush(&local) == 0;
+
+	// Out of range is ignored
+	fb_set(&local, MATRIX, 8, 0, true);
+	fb_set(&local, MATRIX + 1, 0, 0, true);
+	ok = ok && fb_flush(&local) == 0;
+
+	// The driver skips writes that change nothing
+	mat.enable_device(MATRIX);
+	uint32_t frames = mat.get_frame_count();
+	mat.write_digit(MATRIX, Max7219::MAX7219_DIGIT_0, 0x81);
+	mat.write_digit(MATRIX, Max7219::MAX7219_DIGIT_0, 0x81);
+	mat.enable_device(MATRIX);
+	ok = ok && mat.get_frame_count() == frames + 1;
+	mat.invalidate_cache();
+	mat.write_digit(MATRIX, Max7219::MAX7219_DIGIT_0, 0x81);
+	ok = ok && mat.get_frame_count() == frames + 2;
+
+	// Bulk writes check their arguments like write_digit
+	uint8_t data[2] = {0, 0};
+	ok = ok && mat.write_digit_all(Max7219::MAX7219_NO_OP, data, 1) == -4 &&
+		mat.write_digit_all(Max7219::MAX7219_DECODE_MODE, data, 1) == -3 &&
+		mat.write_digit_all(Max7219::MAX7219_DIGIT_0, data, 2) == -1;
+
+	// Time full refreshes of every digit
+	Timer refresh_time;
+	refresh_time.start();
+	for (int i = 0; i < 100; i++) {
+		mat.invalidate_cache();
+		fb_invalidate(&local);
+		fb_flush(&local);
+	}
+	fb_wait(&local);
+	refresh_time.stop();
+	out_printf("  full refresh %d us\n", refresh_time.read_us() / 100);
+
+	fb_clear(&local);
+	fb_flush(&local);
+
+	// The game's framebuffer no longer knows what is shown
+	fb_invalidate(&fb);
+
+	if (!ok) {
+		out_printf("Failed framebuffer test\n");
+		return false;
+	}
+	out_printf("Passed framebuffer test\n");
 	return true;
 }
 
+// Pixel by pixel reference for frame_orient
+static uint64_t orient_slow(uint64_t frame, uint8_t orient) {
+	uint64_t out = 0;
+	for (int x = 0; x < 8; x++) {
+		for (int y = 0; y < 8; y++) {
+			if (!((frame >> (x * 8 + y)) & 1)) {
+				continue;
+			}
+			int nx = x;
+			int ny = y;
+			if (orient & ORIENT_TRANSPOSE) {
+				nx = y;
+				ny = x;
+			}
+			if (orient & ORIENT_FLIP_X) {
+				nx = 7 - nx;
+			}
+			if (orient & ORIENT_FLIP_Y) {
+				ny = 7 - ny;
+			}
+			out |= 1ull << (nx * 8 + ny);
+		}
+	}
+	return out;
+}
+
+// Tests every orientation against the pixel loop, and that a
+// rotated device gets the rotated frame on flush
+bool test_transform() {
+	out_printf("Starting transform test\n");
+	bool ok = true;
+
+	srand(3);
+	for (int i = 0; ok && i < 200; i++) {
+		uint8_t digits[8];
+		for (int x = 0; x < 8; x++) {
+			digits[x] = rand();
+		}
+		uint64_t frame = frame_pack(digits);
+		for (uint8_t orient = 0; ok && orient < 8; orient++) {
+			ok = frame_orient(frame, orient) == orient_slow(frame, orient);
+		}
+
+		uint8_t back[8];
+		frame_unpack(frame, back);
+		ok = ok && memcmp(back, digits, 8) == 0;
+	}
+
+	// Top left pixel of a clockwise device ends up top right
+	framebuffer_t local;
+	fb_init(&local, &mat, MATRIX);
+	fb_orient(&local, MATRIX, ORIENT_ROTATE_CW);
+	fb_set(&local, MATRIX, 0, 0, true);
+	fb_flush(&local);
+	ok = ok && local.shown[0][7] == 0x01 && local.shown[0][0] == 0;
+	fb_clear(&local);
+	fb_flush(&local);
+	fb_invalidate(&fb);
+
+	if (!ok) {
+		out_printf("Failed transform test\n");
+		return false;
+	}
+	out_printf("Passed transform test\n");
+	return true;
+}
+
+// Checkerboard-like pattern for viewport tests
+static int pattern(void* ctx, int x, int y) {
+	return (x * 7 + y * 3) % 5 == 0 || x == y;
+}
+
+// Tests that scrolling a pixel at a time gives the same frame as
+// drawing the window from scratch, on 2x2 and 4x1 device grids
+bool test_viewport() {
+	out_printf("Starting viewport test\n");
+	static framebuffer_t scrolled;
+	static framebuffer_t drawn;
+	bool ok = true;
+
+	for (int grid = 0; ok && grid < 2; grid++) {
+		int cols = grid == 0 ? 2 : 4;
+		int rows = grid == 0 ? 2 : 1;
+		viewport_t view;
+		viewport_t fresh;
+		fb_init(&scrolled, &mat, cols * rows);
+		fb_init(&drawn, &mat, cols * rows);
+		view_init(&view, &scrolled, cols, rows, 40, 30, &pattern, NULL);
+		view_redraw(&view);
+
+		point_t p = {0, 0};
+		srand(grid);
+		for (int i = 0; ok && i < 300; i++) {
+			step((direction) (rand() % 4), &p);
+			p.x = p.x < 0 ? 0 : (p.x > 39 ? 39 : p.x);
+			p.y = p.y < 0 ? 0 : (p.y > 29 ? 29 : p.y);
+			view_follow(&view, p);
+
+			view_init(&fresh, &drawn, cols, rows, 40, 30, &pattern, NULL);
+			fresh.left = view.left;
+			fresh.top = view.top;
+			view_redraw(&fresh);
+
+			ok = memcmp(scrolled.wanted, drawn.wanted, sizeof(drawn.wanted)) == 0 &&
+				view.left >= 0 && view.left + cols * 8 <= 40 &&
+				view.top >= 0 && view.top + rows * 8 <= 30 &&
+				view.left <= p.x && p.x < view.left + cols * 8 &&
+				view.top <= p.y && p.y < view.top + rows * 8;
+		}
+	}
+
+	if (!ok) {
+		out_printf("Failed viewport test\n");
+		return false;
+	}
+	out_printf("Passed viewport test\n");
+	return true;
+}
+
+// Tests that each level is lit for its share of the plane cycle
+bool test_gray() {
+	out_printf("Starting gray test\n");
+	framebuffer_t local;
+	fb_init(&local, &mat, MATRIX);
+
+	// Level x at digit x, for every level
+	gray_clear();
+	fb_plane_t* planes = gray_planes();
+	for (int level = 1; level <= GRAY_MAX; level++) {
+		for (int p = 0; p < GRAY_PLANES; p++) {
+			if ((level >> p) & 1) {
+				planes[p][0][level] = 0x01;
+			}
+		}
+	}
+
+	// Time each digit is lit over whole cycles, measured between
+	// wakeups so it holds whatever else interrupts the sleep
+	int lit_us[GRAY_MAX + 1] = {0};
+	int cycles = 10;
+	int total_us = cycles * GRAY_MAX * GRAY_UNIT_US;
+	Timer timer;
+	gray_start(&local);
+	timer.start();
+	int last = 0;
+	while (last < total_us) {
+		uint8_t shown[GRAY_MAX + 1];
+		memcpy(shown, local.shown[0], sizeof(shown));
+		sleep();
+		int now = timer.read_us();
+		now = now < total_us ? now : total_us;
+		for (int level = 0; level <= GRAY_MAX; level++) {
+			lit_us[level] += (shown[level] & 1) * (now - last);
+		}
+		last = now;
+	}
+	gray_stop();
+
+	// Blank stays blank; the rest within 5% of the whole run, for
+	// flush latency
+	bool ok = !gray_running() && lit_us[0] == 0;
+	for (int level = 1; level <= GRAY_MAX; level++) {
+		int expected = total_us / GRAY_MAX * level;
+		ok = ok && abs(lit_us[level] - expected) <= total_us / 20;
+	}
+
+	gray_clear();
+	fb_clear(&local);
+	fb_flush(&local);
+	fb_invalidate(&fb);
+
+	if (!ok) {
+		out_printf("Failed gray test\n");
+		return false;
+	}
+	out_printf("Passed gray test\n");
+	return true;
+}
 
 // Tests that initialization given the same seed results in the same maze.
 bool test_init_maze() {
-	printf("Starting maze init test\n");
+	out_printf("Starting maze init test\n");
 	srand(0);
 	maze_t* maze_1 = init();
 
@@ -51,77 +322,877 @@ bool test_init_maze() {
 	) {
 		for (int y = 0; y < HEIGHT; y++) {
 			for (int x = 0; x < WIDTH; x++) {
-				if (maze_1->grid[y][x] != maze_2->grid[y][x]) {
-					printf("Failed maze init test\n");
+				if (maze_at(maze_1, x, y) != maze_at(maze_2, x, y)) {
+					out_printf("Failed maze init test\n");
+					free_maze(maze_1);
+					free_maze(maze_2);
 					return false;
 				}
 			}
 		}
 	} else {
-		printf("Failed maze init test\n");
+		out_printf("Failed maze init test\n");
+		free_maze(maze_1);
+		free_maze(maze_2);
 		return false;
 	}
 
-	printf("Passed maze init test\n");
+	free_maze(maze_1);
+	free_maze(maze_2);
+
+	out_printf("Passed maze init test\n");
 	return true;
 }
 
 
 // Tests that opposite is giving the right directions
 bool test_opposite() {
-	printf("Starting opposite test\n");
+	out_printf("Starting opposite test\n");
 	if (!(opposite(NORTH) == SOUTH)) {
-		printf("Failed opposite direction test\n");
+		out_printf("Failed opposite direction test\n");
 		return false;
 	} else if (!(opposite(SOUTH) == NORTH)) {
-		printf("Failed opposite direction test\n");
+		out_printf("Failed opposite direction test\n");
 		return false;
 	} else if (!(opposite(EAST) == WEST)) {
-		printf("Failed opposite direction test\n");
+		out_printf("Failed opposite direction test\n");
 		return false;
 	} else if (!(opposite(WEST) == EAST)) {
-		printf("Failed opposite direction test\n");
+		out_printf("Failed opposite direction test\n");
+		return false;
+	}
+	out_printf("Passed opposite test\n");
+	return true;
+}
+
+
+// Tests next-clear scans across word boundaries and that a reset
+// to a smaller size clears without reallocating
+bool test_bitset() {
+	out_printf("Starting bitset test\n");
+	bitset_t set = {NULL, 0, 0};
+	bool ok = bitset_reset(&set, 100);
+
+	for (size_t i = 0; ok && i < 70; i++) {
+		bitset_set(&set, i);
+	}
+	bitset_set(&set, 71);
+	ok = ok && bitset_next_clear(&set, 0) == 70 &&
+		bitset_next_clear(&set, 71) == 72 &&
+		bitset_get(&set, 69) && !bitset_get(&set, 70);
+
+	for (size_t i = 70; ok && i < 100; i++) {
+		bitset_set(&set, i);
+	}
+	ok = ok && bitset_next_clear(&set, 0) == 100;
+
+	uint32_t* words = set.words;
+	ok = ok && bitset_reset(&set, 40) && set.words == words &&
+		bitset_next_clear(&set, 0) == 0;
+	bitset_free(&set);
+
+	if (!ok) {
+		out_printf("Failed bitset test\n");
 		return false;
 	}
-	printf("Passed opposite test\n");
+	out_printf("Passed bitset test\n");
+	return true;
+}
+
+// Tests the renderer against a hand drawn 2x2 maze
+bool test_render() {
+	out_printf("Starting render test\n");
+	maze_t* maze = new_maze(2, 2);
+	maze_set(maze, 0, 0, mask_of(EAST) | mask_of(SOUTH));
+	maze_set(maze, 1, 0, mask_of(WEST));
+	maze_set(maze, 0, 1, mask_of(NORTH) | mask_of(EAST));
+	maze_set(maze, 1, 1, mask_of(WEST));
+
+	const char* expected =
+		" ___\n"
+		"|  _|\n"
+		"|___|\n";
+
+	char buf[32];
+	size_t len = render_maze(maze, buf, sizeof(buf));
+	free_maze(maze);
+
+	if (len != strlen(expected) || strcmp(buf, expected) != 0) {
+		out_printf("Failed render test\n");
+		return false;
+	}
+	out_printf("Passed render test\n");
+	return true;
+}
+
+// Tests that streaming a maze gives the same bytes as rendering it
+// into a buffer
+bool test_render_to() {
+	out_printf("Starting render stream test\n");
+	srand(2);
+	maze_t* maze = init_maze(4, 3);
+	size_t size = render_size(maze);
+	char* expected = (char*) malloc(size);
+	char* streamed = (char*) calloc(size + 8, 1);
+
+	bool ok = maze != NULL && expected != NULL && streamed != NULL;
+	size_t len = 0;
+	if (ok) {
+		len = render_maze(maze, expected, size);
+		FILE* out = fmemopen(streamed, size + 8, "w");
+		ok = out != NULL && render_to(maze, out) == 0;
+		if (out != NULL) {
+			ok = ftell(out) == (long) len && ok;
+			fclose(out);
+		}
+	}
+	ok = ok && len > 0 && memcmp(streamed, expected, len) == 0;
+
+	free(expected);
+	free(streamed);
+	free_maze(maze);
+
+	if (!ok) {
+		out_printf("Failed render stream test\n");
+		return false;
+	}
+	out_printf("Passed render stream test\n");
+	return true;
+}
+
+// Reads a big-endian 32-bit value
+static uint32_t read_u32(const uint8_t* p) {
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+
+// Bitwise CRC-32 as PNG uses it, independent of image.cpp's table
+static uint32_t test_crc32(const uint8_t* data, size_t len) {
+	uint32_t crc = 0xFFFFFFFF;
+	for (size_t i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (int k = 0; k < 8; k++) {
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+		}
+	}
+	return ~crc;
+}
+
+
+// Whether image pixel px, py of a maze is a wall
+static bool wall_pixel(const maze_t* maze, int px, int py) {
+	if (px == 0 || py == 0 || (px % 2 == 0 && py % 2 == 0)) {
+		return true;
+	}
+	if (px % 2 == 1 && py % 2 == 1) {
+		return false;
+	}
+	cell c = maze_at(maze, (px - 1) / 2, (py - 1) / 2);
+	return px % 2 == 0 ? !can_move(EAST, c) : !can_move(SOUTH, c);
+}
+
+
+// Tests the PBM pixels against the maze walls, and that the PNG is
+// well formed: signature, header fields and every chunk's CRC
+bool test_image() {
+	out_printf("Starting image test\n");
+	const size_t size = 4096;
+	srand(4);
+	maze_t* maze = init_maze(5, 3);
+	uint8_t* buf = (uint8_t*) calloc(size, 1);
+	int width = 2 * 5 + 1;
+	int height = 2 * 3 + 1;
+	size_t stride = (width + 7) / 8;
+
+	// PBM: header, then one packed row per pixel row, 1 for a wall
+	bool ok = maze != NULL && buf != NULL;
+	long len = 0;
+	if (ok) {
+		FILE* out = fmemopen(buf, size, "w");
+		ok = out != NULL && image_write_pbm(maze, out) == 0;
+		if (out != NULL) {
+			len = ftell(out);
+			fclose(out);
+		}
+	}
+	const char* header = "P4\n11 7\n";
+	size_t header_len = strlen(header);
+	ok = ok && len == (long) (header_len + stride * height) &&
+		memcmp(buf, header, header_len) == 0;
+	for (int py = 0; ok && py < height; py++) {
+		const uint8_t* row = buf + header_len + py * stride;
+		for (int px = 0; ok && px < width; px++) {
+			bool set = (row[px >> 3] >> (7 - (px & 7))) & 1;
+			ok = set == wall_pixel(maze, px, py);
+		}
+		// Padding bits at the end of the row stay clear
+		ok = ok && (row[stride - 1] & (0xFF >> (width - (stride - 1) * 8))) == 0;
+	}
+
+	// PNG: signature, IHDR first, IEND last, every CRC right
+	static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	if (ok) {
+		memset(buf, 0, size);
+		FILE* out = fmemopen(buf, size, "w");
+		ok = out != NULL && image_write_png(maze, out) == 0;
+		len = 0;
+		if (out != NULL) {
+			len = ftell(out);
+			fclose(out);
+		}
+	}
+	ok = ok && len > 8 + 25 + 12 && memcmp(buf, signature, 8) == 0;
+	ok = ok && read_u32(&buf[8]) == 13 && memcmp(&buf[12], "IHDR", 4) == 0 &&
+		read_u32(&buf[16]) == (uint32_t) width && read_u32(&buf[20]) == (uint32_t) height &&
+		buf[24] == 1 && buf[25] == 0 && buf[26] == 0 && buf[27] == 0 && buf[28] == 0;
+
+	int chunks = 0;
+	int idat = 0;
+	bool ended = false;
+	long at = 8;
+	while (ok && !ended && at + 12 <= len) {
+		uint32_t chunk_len = read_u32(&buf[at]);
+		ok = at + 12 + (long) chunk_len <= len &&
+			read_u32(&buf[at + 8 + chunk_len]) == test_crc32(&buf[at + 4], chunk_len + 4);
+		if (memcmp(&buf[at + 4], "IDAT", 4) == 0) {
+			idat++;
+		}
+		ended = memcmp(&buf[at + 4], "IEND", 4) == 0;
+		at += 12 + chunk_len;
+		chunks++;
+	}
+	ok = ok && ended && at == len && idat > 0 && chunks == idat + 2;
+
+	free(buf);
+	free_maze(maze);
+
+	if (!ok) {
+		out_printf("Failed image test\n");
+		return false;
+	}
+	out_printf("Passed image test\n");
+	return true;
+}
+
+// Tests that a maze read back from its file matches the original
+bool test_mazefile() {
+	out_printf("Starting maze file test\n");
+	srand(1);
+	maze_t* maze = init_maze(13, 5);
+
+	size_t size = mazefile_size(maze);
+	uint8_t* buf = (uint8_t*) malloc(size);
+	mazefile_t file;
+	bool ok = mazefile_encode(maze, buf, size) == size &&
+		mazefile_view(&file, buf, size) == 0 &&
+		file.width == maze->width && file.height == maze->height &&
+		points_equal(file.exit, maze->exit);
+
+	for (int y = 0; ok && y < maze->height; y++) {
+		for (int x = 0; ok && x < maze->width; x++) {
+			ok = mazefile_at(&file, x, y) == maze_at(maze, x, y);
+		}
+	}
+
+	// A truncated file is rejected
+	if (mazefile_view(&file, buf, size - 1) == 0) {
+		ok = false;
+	}
+
+	// So is a start or exit outside the maze
+	for (int field = 16; ok && field < 32; field += 4) {
+		uint8_t saved[4];
+		memcpy(saved, buf + field, 4);
+		uint32_t limit = (field / 4) % 2 == 0 ? maze->width : maze->height;
+		buf[field] = limit & 0xFF;
+		buf[field + 1] = (limit >> 8) & 0xFF;
+		buf[field + 2] = (limit >> 16) & 0xFF;
+		buf[field + 3] = (limit >> 24) & 0xFF;
+		ok = mazefile_view(&file, buf, size) != 0;
+		memcpy(buf + field, saved, 4);
+	}
+	ok = ok && mazefile_view(&file, buf, size) == 0;
+
+	// And a passage out through the east or south border, which
+	// would let the player walk off the grid
+	size_t row_bytes = (2 * maze->width + 7) / 8;
+	uint8_t* east = buf + MAZEFILE_HEADER + 2 * row_bytes + (maze->width - 1) / 4;
+	uint8_t east_bit = 1 << (((maze->width - 1) & 3) * 2);
+	uint8_t* south = buf + MAZEFILE_HEADER + (maze->height - 1) * row_bytes + 1;
+	uint8_t south_bit = 2 << 2;
+	*east |= east_bit;
+	ok = ok && mazefile_view(&file, buf, size) != 0;
+	*east &= ~east_bit;
+	*south |= south_bit;
+	ok = ok && mazefile_view(&file, buf, size) != 0;
+	*south &= ~south_bit;
+	ok = ok && mazefile_view(&file, buf, size) == 0;
+
+	free(buf);
+	free_maze(maze);
+
+	if (!ok) {
+		out_printf("Failed maze file test\n");
+		return false;
+	}
+	out_printf("Passed maze file test\n");
+	return true;
+}
+
+// Tests that compressed mazes decode to the original
+bool test_treecode() {
+	out_printf("Starting tree code test\n");
+	const int rounds = 50;
+	bool ok = true;
+	size_t bytes = 0;
+	size_t cells = 0;
+	Timer encode_time;
+	Timer decode_time;
+
+	for (int i = 0; ok && i < rounds; i++) {
+		srand(i);
+		maze_t* maze = init();
+		size_t size = maze != NULL ? tree_bound(maze) : 0;
+		uint8_t* buf = (uint8_t*) malloc(size);
+		if (maze == NULL || buf == NULL) {
+			free(buf);
+			free_maze(maze);
+			ok = false;
+			break;
+		}
+
+		encode_time.start();
+		size_t len = tree_encode(maze, buf, size);
+		encode_time.stop();
+
+		decode_time.start();
+		maze_t* copy = tree_decode(buf, len);
+		decode_time.stop();
+
+		ok = len > 0 && copy != NULL &&
+			copy->width == maze->width && copy->height == maze->height &&
+			points_equal(copy->start, maze->start) &&
+			points_equal(copy->exit, maze->exit);
+		for (int y = 0; ok && y < maze->height; y++) {
+			for (int x = 0; ok && x < maze->width; x++) {
+				ok = maze_at(copy, x, y) == maze_at(maze, x, y);
+			}
+		}
+
+		bytes += len;
+		cells += (size_t) maze->width * maze->height;
+		free(buf);
+		free_maze(copy);
+		free_maze(maze);
+	}
+
+	// Throughput only means something on the board; the host clock
+	// does not move here, and maze_bench times both on the host
+	if (ok) {
+		int encode_us = encode_time.read_us();
+		int decode_us = decode_time.read_us();
+		out_printf("  %d.%02d bits/cell\n",
+			(int) (bytes * 8 / cells), (int) (bytes * 800 / cells % 100));
+		if (encode_us > 0 && decode_us > 0) {
+			out_printf("  encode %d cells/ms, decode %d cells/ms\n",
+				(int) (cells * 1000 / encode_us), (int) (cells * 1000 / decode_us));
+		}
+	}
+
+	if (!ok) {
+		out_printf("Failed tree code test\n");
+		return false;
+	}
+	out_printf("Passed tree code test\n");
+	return true;
+}
+
+// Tests that a maze built a few steps at a time, with one
+// generator reused across sizes, matches one built in a single call
+bool test_generator() {
+	out_printf("Starting generator test\n");
+	gen_t gen = {NULL, NULL, 0, 0, {0, 0}, {NULL, 0, 0}};
+	bool ok = true;
+
+	for (int i = 0; ok && i < 20; i++) {
+		int width = 2 + i * 3 % 17;
+		int height = 2 + i * 7 % 13;
+		srand(i);
+		maze_t* whole = init_maze(width, height);
+		maze_t* sliced = new_maze(width, height);
+
+		srand(i);
+		ok = whole != NULL && sliced != NULL && gen_begin(&gen, sliced);
+		int slices = 0;
+		while (ok && !gen_step(&gen, 1 + i % 5)) {
+			slices++;
+		}
+		ok = ok && gen_done(&gen) && slices > 0;
+
+		for (int y = 0; ok && y < height; y++) {
+			for (int x = 0; ok && x < width; x++) {
+				ok = maze_at(whole, x, y) == maze_at(sliced, x, y);
+			}
+		}
+		free_maze(whole);
+		free_maze(sliced);
+	}
+	gen_free(&gen);
+
+	if (!ok) {
+		out_printf("Failed generator test\n");
+		return false;
+	}
+	out_printf("Passed generator test\n");
+	return true;
+}
+
+// Tests that prepared mazes follow the same sequence as mazes
+// generated on demand, and that a size change drops the spare
+bool test_prepare_maze() {
+	out_printf("Starting prepare maze test\n");
+	srand(7);
+	maze_t* expect[3];
+	for (int i = 0; i < 3; i++) {
+		expect[i] = init_maze(12, 9);
+	}
+
+	// First round on demand, the rest prepared, the last one only
+	// partly before it is taken, and asked for again meanwhile
+	srand(7);
+	maze_t* got[3];
+	got[0] = take_maze(12, 9);
+	prepare_maze(12, 9);
+	while (prepare_step());
+	got[1] = take_maze(12, 9);
+	prepare_maze(12, 9);
+	prepare_step();
+	prepare_maze(12, 9);
+	got[2] = take_maze(12, 9);
+
+	bool ok = true;
+	for (int i = 0; i < 3; i++) {
+		ok = ok && got[i] != NULL;
+		for (int y = 0; ok && y < 9; y++) {
+			for (int x = 0; ok && x < 12; x++) {
+				ok = maze_at(expect[i], x, y) == maze_at(got[i], x, y);
+			}
+		}
+		free_maze(expect[i]);
+		free_maze(got[i]);
+	}
+
+	prepare_maze(12, 9);
+	maze_t* other = take_maze(10, 10);
+	ok = ok && other != NULL && other->width == 10 && !prepare_step();
+	free_maze(other);
+	discard_maze();
+
+	if (!ok) {
+		out_printf("Failed prepare maze test\n");
+		return false;
+	}
+	out_printf("Passed prepare maze test\n");
+	return true;
+}
+
+// Tests that a tiled maze generates the same as a row-major one
+// from the same seed, including sizes that are not whole tiles
+bool test_layouts() {
+	out_printf("Starting layout test\n");
+	bool ok = true;
+
+	for (int i = 0; ok && i < 20; i++) {
+		int width = 3 + i * 7 % 29;
+		int height = 2 + i * 5 % 23;
+		maze_t* rows = new_maze_layout(width, height, LAYOUT_ROWS);
+		maze_t* tiled = new_maze_layout(width, height, LAYOUT_TILED);
+		srand(i);
+		generate(rows);
+		srand(i);
+		generate(tiled);
+
+		for (int y = 0; ok && y < height; y++) {
+			for (int x = 0; ok && x < width; x++) {
+				ok = maze_at(rows, x, y) == maze_at(tiled, x, y);
+			}
+		}
+		ok = ok && path_length(rows) == path_length(tiled) && path_length(rows) > 0;
+		free_maze(rows);
+		free_maze(tiled);
+	}
+
+	ok = ok && bench_layouts(64, 128);
+
+	if (!ok) {
+		out_printf("Failed layout test\n");
+		return false;
+	}
+	out_printf("Passed layout test\n");
+	return true;
+}
+
+// Side of the region searched for connectivity, in chunks
+#define REACH_CHUNKS 3
+#define REACH_SIZE (REACH_CHUNKS * CHUNK_SIZE)
+
+// Breadth-first search from (x, y) over the REACH_CHUNKS square of
+// chunks whose top left chunk is (cx, cy). Returns the cells reached.
+static int world_reach(world_t* world, int cx, int cy, int x, int y) {
+	static point_t queue[REACH_SIZE * REACH_SIZE];
+	static bool seen[REACH_SIZE][REACH_SIZE];
+	int left = cx * CHUNK_SIZE;
+	int top = cy * CHUNK_SIZE;
+	int head = 0;
+	int tail = 0;
+
+	memset(seen, 0, sizeof(seen));
+	point_t start = {x, y};
+	seen[y - top][x - left] = true;
+	queue[tail++] = start;
+
+	while (head < tail) {
+		point_t p = queue[head++];
+		cell c = world_at(world, p.x, p.y);
+		for (int d = NORTH; d <= WEST; d++) {
+			point_t next = p;
+			step((direction) d, &next);
+			int i = next.x - left;
+			int j = next.y - top;
+			if (can_move((direction) d, c) && 0 <= i && i < REACH_SIZE &&
+				0 <= j && j < REACH_SIZE && !seen[j][i])
+			{
+				seen[j][i] = true;
+				queue[tail++] = next;
+			}
+		}
+	}
+	return tail;
+}
+
+
+// Tests that neighbouring cells agree on their shared walls across
+// chunk borders, that evicted chunks are rebuilt identically, and
+// that the world stays connected across chunk seams
+bool test_world() {
+	out_printf("Starting world test\n");
+	static world_t world;
+	static world_t fresh;
+	init_world(&world, 42);
+	init_world(&fresh, 42);
+	bool ok = true;
+
+	for (int y = -12; ok && y < 12; y++) {
+		for (int x = -12; ok && x < 12; x++) {
+			cell c = world_at(&world, x, y);
+			ok = can_move(EAST, c) == can_move(WEST, world_at(&world, x + 1, y)) &&
+				can_move(SOUTH, c) == can_move(NORTH, world_at(&world, x, y + 1)) &&
+				c == world_at(&fresh, x, y);
+		}
+	}
+
+	// Every cell of 3x3 chunks around the origin is reachable from
+	// it, through the openings in the chunk seams
+	ok = ok && world_reach(&world, -1, -1, 0, 0) == REACH_SIZE * REACH_SIZE;
+
+	// The same from a chunk the cache evicted and had to rebuild:
+	// touching more chunks than it holds pushes (5, 5) out
+	init_world(&world, 7);
+	world_at(&world, 5 * CHUNK_SIZE, 5 * CHUNK_SIZE);
+	for (int i = 0; i < WORLD_CACHE; i++) {
+		world_at(&world, -20 * CHUNK_SIZE, i * CHUNK_SIZE);
+	}
+	for (int i = 0; i < WORLD_CACHE; i++) {
+		chunk_t* chunk = &world.cache[i];
+		ok = ok && !(chunk->valid && chunk->cx == 5 && chunk->cy == 5);
+	}
+	ok = ok && world_reach(&world, 5, 5, 5 * CHUNK_SIZE + 3, 5 * CHUNK_SIZE + 4) ==
+		REACH_SIZE * REACH_SIZE;
+
+	if (!ok) {
+		out_printf("Failed world test\n");
+		return false;
+	}
+	out_printf("Passed world test\n");
+	return true;
+}
+
+// Tests that keystrokes update position and turn count correctly
+bool test_apply_input() {
+	out_printf("Starting apply input test\n");
+	srand(0);
+	state_t* state = init_state();
+	if (state == NULL) {
+		out_printf("Failed apply input test\n");
+		return false;
+	}
+	point_t start = state->curr_pos;
+	bool ok = true;
+
+	// Invalid keys are not a turn
+	if (apply_input('x', state) != MOVE_INVALID || state->turns != 0) {
+		ok = false;
+	}
+
+	// The start cell is on the top edge so north is always a wall
+	if (apply_input('w', state) != MOVE_BLOCKED ||
+		state->turns != 1 ||
+		!points_equal(state->curr_pos, start))
+	{
+		ok = false;
+	}
+
+	free_state(state);
+
+	if (!ok) {
+		out_printf("Failed apply input test\n");
+		return false;
+	}
+	out_printf("Passed apply input test\n");
+	return true;
+}
+
+// Tests that a status survives framing and a corrupted frame is dropped
+bool test_protocol() {
+	out_printf("Starting protocol test\n");
+	proto_status_t sent = {PROTO_BLOCKED, 3, 300, 1234};
+	uint8_t payload[PROTO_STATUS_SIZE];
+	uint8_t frame[PROTO_MAX_FRAME];
+	proto_pack_status(&sent, payload);
+	size_t len = proto_encode(payload, PROTO_STATUS_SIZE, frame);
+
+	proto_parser_t parser;
+	proto_reset(&parser);
+	int result = 0;
+	for (size_t i = 0; i < len; i++) {
+		result = proto_feed(&parser, frame[i]);
+	}
+
+	proto_status_t received;
+	bool ok = result == 1 &&
+		proto_unpack_status(parser.payload, parser.len, &received) == 0 &&
+		received.flags == sent.flags && received.x == sent.x &&
+		received.y == sent.y && received.turns == sent.turns;
+
+	// Flip a payload bit
+	frame[3] ^= 0x10;
+	for (size_t i = 0; i < len; i++) {
+		result = proto_feed(&parser, frame[i]);
+	}
+	if (result != -1 || parser.errors != 1) {
+		ok = false;
+	}
+
+	if (!ok) {
+		out_printf("Failed protocol test\n");
+		return false;
+	}
+	out_printf("Passed protocol test\n");
+	return true;
+}
+
+// Plays every bot over a batch of mazes. Every bot except the random
+// walk must solve each maze.
+bool test_bots() {
+	out_printf("Starting bot test\n");
+	bool ok = true;
+
+	for (int k = BOT_RANDOM; k <= BOT_SOLVER; k++) {
+		bot_kind kind = (bot_kind) k;
+		bot_stats_t stats;
+		run_bot(kind, 0, 20, 2000, NULL, &stats);
+
+		// Timings only mean something on the board; maze_bench times
+		// the bots on the host, with the display drawn
+		out_printf("  %s: %d/%d solved, %d moves\n",
+			bot_name(kind), stats.completed, stats.rounds, stats.moves);
+		if (stats.elapsed_us > 0) {
+			out_printf("    %d moves/s, p50 %dus p90 %dus p99 %dus\n",
+				(int) (stats.moves * 1000000ULL / stats.elapsed_us),
+				stats.p50_us, stats.p90_us, stats.p99_us);
+		}
+
+		if (kind != BOT_RANDOM && stats.completed != stats.rounds) {
+			ok = false;
+		}
+	}
+
+	if (!ok) {
+		out_printf("Failed bot test\n");
+		return false;
+	}
+	out_printf("Passed bot test\n");
 	return true;
 }
 
 // Main test runner
-void run_tests() {
+int run_tests() {
 	// Enable red LED during test
 	led1.write(0);
 
 	int passed = 0;
 	int failed = 0;
 
+	// The output queue drops what does not fit, so it is drained
+	// after every test to keep all of the results
 	if (test_led()) {
 		passed += 1;
 	} else {
 		failed += 1;
 	}
+	out_flush();
+
+	if (test_animation()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_framebuffer()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_transform()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_viewport()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_gray()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
 
 	if (test_init_maze()) {
 		passed += 1;
 	} else {
 		failed += 1;
 	}
+	out_flush();
 
 	if (test_opposite()) {
 		passed += 1;
 	} else {
 		failed += 1;
 	}
+	out_flush();
+
+	if (test_bitset()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_render()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_render_to()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_image()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_mazefile()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_treecode()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_generator()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_prepare_maze()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_layouts()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_world()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_apply_input()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_protocol()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
+
+	if (test_bots()) {
+		passed += 1;
+	} else {
+		failed += 1;
+	}
+	out_flush();
 
 	if (passed) {
-		printf("Passed %d tests\n", passed);
+		out_printf("Passed %d tests\n", passed);
 	}
 	if (failed) {
-		printf("Failed %d tests\n", failed);
+		out_printf("Failed %d tests\n", failed);
 	}
-	printf("\n");
+	out_printf("\n");
+	out_flush();
 
 	wait(1);
 
 	led1.write(1);
+	return failed;
 }
@@ -8,12 +8,42 @@
 #define TEST_H_
 
 #include "main.h"
+#include "bot.h"
+#include "mazefile.h"
+#include "image.h"
+#include "treecode.h"
+#include "bench.h"
 
 /**
  * A simple LED test.
  */
 bool test_led();
 
+/**
+ * LED animation test.
+ */
+bool test_animation();
+
+/**
+ * LED framebuffer test.
+ */
+bool test_framebuffer();
+
+/**
+ * Frame orientation test.
+ */
+bool test_transform();
+
+/**
+ * LED viewport scrolling test.
+ */
+bool test_viewport();
+
+/**
+ * Grayscale duty cycle test.
+ */
+bool test_gray();
+
 /**
  * Maze initialization test.
  */
@@ -26,8 +56,75 @@ bool test_init_maze();
 bool test_opposite();
 
 /**
- * Main test runner.
+ * Bitset test.
+ */
+bool test_bitset();
+
+/**
+ * ASCII renderer test.
+ */
+bool test_render();
+
+/**
+ * Streamed renderer test.
+ */
+bool test_render_to();
+
+/**
+ * PBM and PNG image export test.
+ */
+bool test_image();
+
+/**
+ * Maze file encode and decode test.
+ */
+bool test_mazefile();
+
+/**
+ * Spanning tree compression test. Also prints compression ratio
+ * and throughput.
+ */
+bool test_treecode();
+
+/**
+ * Time-sliced generation test.
+ */
+bool test_generator();
+
+/**
+ * Next maze preparation test.
+ */
+bool test_prepare_maze();
+
+/**
+ * Cell layout test. Also prints generation and solve throughput
+ * for each layout.
+ */
+bool test_layouts();
+
+/**
+ * Endless world consistency test.
+ */
+bool test_world();
+
+/**
+ * Keystroke handling test.
+ */
+bool test_apply_input();
+
+/**
+ * Binary protocol framing test.
+ */
+bool test_protocol();
+
+/**
+ * Bot harness test. Also prints load-test statistics.
+ */
+bool test_bots();
+
+/**
+ * Main test runner. Returns the number of failed tests.
  */
-void run_tests();
+int run_tests();
 
 #endif /* TEST_H_ */
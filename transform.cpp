@@ -0,0 +1,74 @@
+/*
+ * transform.cpp
+ *
+ */
+
+#include "transform.h"
+
+/*---------------------------------------------------------------
+  Transform functions
+ *---------------------------------------------------------------*/
+
+// Digit x goes to byte x
+uint64_t frame_pack(const uint8_t digits[8]) {
+	uint64_t frame = 0;
+	for (int x = 7; x >= 0; x--) {
+		frame = (frame << 8) | digits[x];
+	}
+	return frame;
+}
+
+
+// Byte x goes to digit x
+void frame_unpack(uint64_t frame, uint8_t digits[8]) {
+	for (int x = 0; x < 8; x++) {
+		digits[x] = (uint8_t) frame;
+		frame >>= 8;
+	}
+}
+
+
+// Transposes 2x2 blocks of bits, then 2x2 blocks of those, then of
+// 4x4 blocks, swapping the off-diagonal quarters at each level
+uint64_t frame_transpose(uint64_t frame) {
+	uint64_t t;
+	t = (frame ^ (frame >> 7)) & 0x00AA00AA00AA00AAull;
+	frame = frame ^ t ^ (t << 7);
+	t = (frame ^ (frame >> 14)) & 0x0000CCCC0000CCCCull;
+	frame = frame ^ t ^ (t << 14);
+	t = (frame ^ (frame >> 28)) & 0x00000000F0F0F0F0ull;
+	frame = frame ^ t ^ (t << 28);
+	return frame;
+}
+
+
+// Swaps neighbouring bytes, then pairs, then halves
+uint64_t frame_flip_x(uint64_t frame) {
+	frame = ((frame >> 8) & 0x00FF00FF00FF00FFull) | ((frame & 0x00FF00FF00FF00FFull) << 8);
+	frame = ((frame >> 16) & 0x0000FFFF0000FFFFull) | ((frame & 0x0000FFFF0000FFFFull) << 16);
+	return (frame >> 32) | (frame << 32);
+}
+
+
+// Swaps neighbouring bits, then pairs, then nibbles, in all bytes
+// at once
+uint64_t frame_flip_y(uint64_t frame) {
+	frame = ((frame >> 1) & 0x5555555555555555ull) | ((frame & 0x5555555555555555ull) << 1);
+	frame = ((frame >> 2) & 0x3333333333333333ull) | ((frame & 0x3333333333333333ull) << 2);
+	return ((frame >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((frame & 0x0F0F0F0F0F0F0F0Full) << 4);
+}
+
+
+// Transpose first, then the flips
+uint64_t frame_orient(uint64_t frame, uint8_t orient) {
+	if (orient & ORIENT_TRANSPOSE) {
+		frame = frame_transpose(frame);
+	}
+	if (orient & ORIENT_FLIP_X) {
+		frame = frame_flip_x(frame);
+	}
+	if (orient & ORIENT_FLIP_Y) {
+		frame = frame_flip_y(frame);
+	}
+	return frame;
+}
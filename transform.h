@@ -0,0 +1,66 @@
+/*
+ * transform.h
+ *
+ * Orientation changes of whole 8x8 LED frames. A frame is packed
+ * into 64 bits, digit x in byte x and row y in bit y of that byte,
+ * and transformed with a handful of shifts and masks instead of a
+ * loop over pixels.
+ */
+
+#ifndef TRANSFORM_H_
+#define TRANSFORM_H_
+
+#include "mbed.h"
+
+
+/*---------------------------------------------------------------
+  Transform constants
+ *---------------------------------------------------------------*/
+
+// Orientation flags, applied in this order
+#define ORIENT_NORMAL 0
+#define ORIENT_TRANSPOSE 1	// (x, y) -> (y, x)
+#define ORIENT_FLIP_X 2		// (x, y) -> (7 - x, y)
+#define ORIENT_FLIP_Y 4		// (x, y) -> (x, 7 - y)
+
+// Turns, with y pointing down
+#define ORIENT_ROTATE_CW (ORIENT_TRANSPOSE | ORIENT_FLIP_X)
+#define ORIENT_ROTATE_180 (ORIENT_FLIP_X | ORIENT_FLIP_Y)
+#define ORIENT_ROTATE_CCW (ORIENT_TRANSPOSE | ORIENT_FLIP_Y)
+
+
+/*---------------------------------------------------------------
+  Transform functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Packs 8 digit bytes into a frame.
+ */
+uint64_t frame_pack(const uint8_t digits[8]);
+
+/**
+ * Unpacks a frame into 8 digit bytes.
+ */
+void frame_unpack(uint64_t frame, uint8_t digits[8]);
+
+/**
+ * Swaps the x and y axes.
+ */
+uint64_t frame_transpose(uint64_t frame);
+
+/**
+ * Reverses the order of the digits.
+ */
+uint64_t frame_flip_x(uint64_t frame);
+
+/**
+ * Reverses the bits of every digit.
+ */
+uint64_t frame_flip_y(uint64_t frame);
+
+/**
+ * Applies a combination of ORIENT_ flags.
+ */
+uint64_t frame_orient(uint64_t frame, uint8_t orient);
+
+#endif /* TRANSFORM_H_ */
@@ -0,0 +1,344 @@
+/*
+ * treecode.cpp
+ *
+ */
+
+#include "treecode.h"
+
+/*---------------------------------------------------------------
+  Range coder
+ *---------------------------------------------------------------*/
+
+// Binary range coder with 11-bit adaptive probabilities
+#define PROB_BITS 11
+#define PROB_INIT (1 << (PROB_BITS - 1))
+#define PROB_SHIFT 5
+#define RANGE_TOP (1u << 24)
+
+// One probability per direction and number of passages already
+// found at the cell (0, 1, 2+)
+#define CONTEXTS 12
+
+typedef struct {
+	uint64_t low;
+	uint32_t range;
+	uint8_t cache;
+	uint32_t cache_size;
+	uint8_t* out;
+	size_t size;
+	size_t pos;
+} encoder_t;
+
+typedef struct {
+	uint32_t code;
+	uint32_t range;
+	const uint8_t* in;
+	size_t len;
+	size_t pos;
+} decoder_t;
+
+
+// Emits a byte, remembering overflow as pos past size
+static void put_byte(encoder_t* enc, uint8_t byte) {
+	if (enc->pos < enc->size) {
+		enc->out[enc->pos] = byte;
+	}
+	enc->pos++;
+}
+
+
+// Moves the top byte of low out, propagating any carry
+static void shift_low(encoder_t* enc) {
+	if ((uint32_t) enc->low < 0xFF000000u || (enc->low >> 32) != 0) {
+		uint8_t carry = enc->low >> 32;
+		uint8_t temp = enc->cache;
+		do {
+			put_byte(enc, temp + carry);
+			temp = 0xFF;
+		} while (--enc->cache_size != 0);
+		enc->cache = (enc->low >> 24) & 0xFF;
+	}
+	enc->cache_size++;
+	enc->low = (enc->low & 0x00FFFFFF) << 8;
+}
+
+
+static void encode_bit(encoder_t* enc, uint16_t* prob, int bit) {
+	uint32_t bound = (enc->range >> PROB_BITS) * *prob;
+	if (bit == 0) {
+		enc->range = bound;
+		*prob += ((1 << PROB_BITS) - *prob) >> PROB_SHIFT;
+	} else {
+		enc->low += bound;
+		enc->range -= bound;
+		*prob -= *prob >> PROB_SHIFT;
+	}
+	while (enc->range < RANGE_TOP) {
+		enc->range <<= 8;
+		shift_low(enc);
+	}
+}
+
+
+static void encode_flush(encoder_t* enc) {
+	for (int i = 0; i < 5; i++) {
+		shift_low(enc);
+	}
+}
+
+
+// Reads a byte, returning zeros past the end
+static uint8_t get_byte(decoder_t* dec) {
+	return dec->pos < dec->len ? dec->in[dec->pos++] : 0;
+}
+
+
+static void decode_init(decoder_t* dec) {
+	dec->code = 0;
+	dec->range = 0xFFFFFFFFu;
+	for (int i = 0; i < 5; i++) {
+		dec->code = (dec->code << 8) | get_byte(dec);
+	}
+}
+
+
+static int decode_bit(decoder_t* dec, uint16_t* prob) {
+	uint32_t bound = (dec->range >> PROB_BITS) * *prob;
+	int bit;
+	if (dec->code < bound) {
+		dec->range = bound;
+		*prob += ((1 << PROB_BITS) - *prob) >> PROB_SHIFT;
+		bit = 0;
+	} else {
+		dec->code -= bound;
+		dec->range -= bound;
+		*prob -= *prob >> PROB_SHIFT;
+		bit = 1;
+	}
+	while (dec->range < RANGE_TOP) {
+		dec->range <<= 8;
+		dec->code = (dec->code << 8) | get_byte(dec);
+	}
+	return bit;
+}
+
+
+/*---------------------------------------------------------------
+  Header
+ *---------------------------------------------------------------*/
+
+// Unsigned LEB128
+static void put_varint(encoder_t* enc, uint32_t v) {
+	while (v >= 0x80) {
+		put_byte(enc, (v & 0x7F) | 0x80);
+		v >>= 7;
+	}
+	put_byte(enc, v);
+}
+
+
+// Returns false on truncated or oversized input
+static bool get_varint(decoder_t* dec, uint32_t* v) {
+	*v = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		if (dec->pos >= dec->len) {
+			return false;
+		}
+		uint8_t byte = dec->in[dec->pos++];
+		*v |= (uint32_t) (byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/*---------------------------------------------------------------
+  Tree walk
+ *---------------------------------------------------------------*/
+
+// Walk state shared by the encoder and decoder, which must visit
+// cells and ask about neighbours in exactly the same order
+typedef struct {
+	int width;
+	int height;
+	bitset_t visited;
+	point_t* stack;
+	int top;
+	uint16_t probs[CONTEXTS];
+} walk_t;
+
+
+static bool walk_init(walk_t* walk, int width, int height) {
+	size_t cells = (size_t) width * height;
+	walk->width = width;
+	walk->height = height;
+	walk->visited.words = NULL;
+	walk->visited.capacity = 0;
+	walk->stack = (point_t*) malloc(cells * sizeof(point_t));
+	walk->top = 0;
+	for (int i = 0; i < CONTEXTS; i++) {
+		walk->probs[i] = PROB_INIT;
+	}
+	return bitset_reset(&walk->visited, cells) && walk->stack != NULL;
+}
+
+
+static void walk_free(walk_t* walk) {
+	bitset_free(&walk->visited);
+	free(walk->stack);
+}
+
+
+static bool visited(walk_t* walk, point_t p) {
+	return bitset_get(&walk->visited, (size_t) p.y * walk->width + p.x);
+}
+
+
+static void visit(walk_t* walk, point_t p) {
+	bitset_set(&walk->visited, (size_t) p.y * walk->width + p.x);
+}
+
+
+static bool walk_in_bounds(walk_t* walk, point_t p) {
+	return 0 <= p.x && p.x < walk->width && 0 <= p.y && p.y < walk->height;
+}
+
+
+/*---------------------------------------------------------------
+  Tree code functions
+ *---------------------------------------------------------------*/
+
+// Header, plus at most 3 questions per cell (4 at the start) each
+// costing under 6.1 bits at the most skewed probability, plus the
+// coder flush
+size_t tree_bound(const maze_t* maze) {
+	size_t cells = (size_t) maze->width * maze->height;
+	return 6 * 5 + (cells * 3 + 1) * 61 / 80 + 1 + 5;
+}
+
+
+// Walks the tree from the start, coding each new neighbour
+size_t tree_encode(const maze_t* maze, uint8_t* out, size_t size) {
+	encoder_t enc = {0, 0xFFFFFFFFu, 0, 1, out, size, 0};
+	walk_t walk;
+	bool ok = walk_init(&walk, maze->width, maze->height);
+
+	put_varint(&enc, maze->width);
+	put_varint(&enc, maze->height);
+	put_varint(&enc, maze->start.x);
+	put_varint(&enc, maze->start.y);
+	put_varint(&enc, maze->exit.x);
+	put_varint(&enc, maze->exit.y);
+
+	if (ok) {
+		visit(&walk, maze->start);
+		walk.stack[walk.top++] = maze->start;
+	}
+
+	while (ok && walk.top > 0) {
+		point_t p = walk.stack[--walk.top];
+		cell curr = maze_at(maze, p.x, p.y);
+		int found = 0;
+
+		for (int d = NORTH; d <= WEST; d++) {
+			direction dir = (direction) d;
+			point_t next = p;
+			step(dir, &next);
+			if (!walk_in_bounds(&walk, next) || visited(&walk, next)) {
+				continue;
+			}
+
+			int open = can_move(dir, curr) ? 1 : 0;
+			encode_bit(&enc, &walk.probs[d * 3 + (found < 2 ? found : 2)], open);
+			if (open) {
+				visit(&walk, next);
+				walk.stack[walk.top++] = next;
+				found++;
+			}
+		}
+	}
+
+	encode_flush(&enc);
+
+	// Every passage of a spanning tree leads to a new cell, so a
+	// tree reaches all cells using exactly cells - 1 passages
+	size_t cells = (size_t) maze->width * maze->height;
+	bool reached_all = ok && bitset_next_clear(&walk.visited, 0) == cells;
+	walk_free(&walk);
+
+	size_t passages = 0;
+	for (int y = 0; y < maze->height; y++) {
+		for (int x = 0; x < maze->width; x++) {
+			cell c = maze_at(maze, x, y);
+			passages += can_move(EAST, c) + can_move(SOUTH, c);
+		}
+	}
+
+	if (!reached_all || passages != cells - 1 || enc.pos > size) {
+		return 0;
+	}
+	return enc.pos;
+}
+
+
+// Replays the walk, carving wherever the coded bit says so
+maze_t* tree_decode(const uint8_t* data, size_t len) {
+	decoder_t dec = {0, 0, data, len, 0};
+	uint32_t width, height, sx, sy, ex, ey;
+
+	if (!get_varint(&dec, &width) || !get_varint(&dec, &height) ||
+		!get_varint(&dec, &sx) || !get_varint(&dec, &sy) ||
+		!get_varint(&dec, &ex) || !get_varint(&dec, &ey) ||
+		width == 0 || height == 0 || width > INT32_MAX || height > INT32_MAX ||
+		sx >= width || sy >= height || ex >= width || ey >= height)
+	{
+		return NULL;
+	}
+
+	// walk_init sets up both buffers even when one fails, so
+	// walk_free releases whichever it did get
+	maze_t* maze = new_maze(width, height);
+	walk_t walk;
+	bool ok = walk_init(&walk, width, height);
+	if (maze == NULL || !ok) {
+		walk_free(&walk);
+		free_maze(maze);
+		return NULL;
+	}
+
+	maze->start.x = sx;
+	maze->start.y = sy;
+	maze->exit.x = ex;
+	maze->exit.y = ey;
+
+	decode_init(&dec);
+	visit(&walk, maze->start);
+	walk.stack[walk.top++] = maze->start;
+
+	while (walk.top > 0) {
+		point_t p = walk.stack[--walk.top];
+		int found = 0;
+
+		for (int d = NORTH; d <= WEST; d++) {
+			direction dir = (direction) d;
+			point_t next = p;
+			step(dir, &next);
+			if (!walk_in_bounds(&walk, next) || visited(&walk, next)) {
+				continue;
+			}
+
+			if (decode_bit(&dec, &walk.probs[d * 3 + (found < 2 ? found : 2)])) {
+				maze_set(maze, p.x, p.y, maze_at(maze, p.x, p.y) | mask_of(dir));
+				maze_set(maze, next.x, next.y, maze_at(maze, next.x, next.y) | mask_of(opposite(dir)));
+				visit(&walk, next);
+				walk.stack[walk.top++] = next;
+				found++;
+			}
+		}
+	}
+
+	walk_free(&walk);
+	return maze;
+}
@@ -0,0 +1,41 @@
+/*
+ * treecode.h
+ *
+ * Compressed storage for perfect mazes. A maze from backtrack is a
+ * spanning tree, so it is rebuilt exactly from a walk that records,
+ * for each newly reached neighbour of a cell, whether a passage
+ * leads to it. Those choices are arithmetic coded with adaptive
+ * probabilities, which brings a maze well under the 2 bits per cell
+ * of the raw wall format.
+ */
+
+#ifndef TREECODE_H_
+#define TREECODE_H_
+
+#include "mbed.h"
+#include "maze.h"
+
+
+/*---------------------------------------------------------------
+  Tree code functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Returns an upper bound on the encoded size of a maze in bytes.
+ */
+size_t tree_bound(const maze_t* maze);
+
+/**
+ * Encodes a perfect maze into out. Returns the number of bytes
+ * written, or 0 if out is too small or the maze is not a spanning
+ * tree (it has a loop or an unreachable cell).
+ */
+size_t tree_encode(const maze_t* maze, uint8_t* out, size_t size);
+
+/**
+ * Decodes a maze written by tree_encode.
+ * Returns NULL if the data is malformed or out of memory.
+ */
+maze_t* tree_decode(const uint8_t* data, size_t len);
+
+#endif /* TREECODE_H_ */
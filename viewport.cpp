@@ -0,0 +1,192 @@
+/*
+ * viewport.cpp
+ *
+ */
+
+#include "viewport.h"
+
+/*---------------------------------------------------------------
+  Pixel access
+ *---------------------------------------------------------------*/
+
+// Column byte of the device holding pixel column px, device row r,
+// in bit-plane p
+static uint8_t* column(viewport_t* view, int p, int px, int r) {
+	int device = r * view->cols + (px >> 3);
+	return &(*view->planes[p])[device][px & 7];
+}
+
+
+// Sets one window pixel from the source, in every plane
+static void draw(viewport_t* view, int px, int py) {
+	int level = view->source(view->ctx, view->left + px, view->top + py);
+	uint8_t bit = 1 << (py & 7);
+
+	if (view->num_planes == 1) {
+		level = level ? 1 : 0;
+	}
+
+	for (int p = 0; p < view->num_planes; p++) {
+		uint8_t* c = column(view, p, px, py >> 3);
+		if ((level >> p) & 1) {
+			*c |= bit;
+		} else {
+			*c &= ~bit;
+		}
+	}
+}
+
+
+
+/*---------------------------------------------------------------
+  Scrolling
+ *---------------------------------------------------------------*/
+
+// Moves the window one cell right (dir 1) or left (dir -1). Every
+// column byte moves over by one, then the exposed column is drawn.
+static void scroll_x(viewport_t* view, int dir) {
+	int w = view->cols * 8;
+	int h = view->rows * 8;
+	int first = dir > 0 ? 0 : w - 1;
+	int last = dir > 0 ? w - 1 : 0;
+
+	for (int p = 0; p < view->num_planes; p++) {
+		for (int r = 0; r < view->rows; r++) {
+			for (int px = first; px != last; px += dir) {
+				*column(view, p, px, r) = *column(view, p, px + dir, r);
+			}
+		}
+	}
+
+	view->left += dir;
+	for (int py = 0; py < h; py++) {
+		draw(view, last, py);
+	}
+}
+
+
+// Moves the window one cell down (dir 1) or up (dir -1). Each
+// column shifts by a bit, carrying across device rows, then the
+// exposed row is drawn.
+static void scroll_y(viewport_t* view, int dir) {
+	int w = view->cols * 8;
+	int h = view->rows * 8;
+
+	for (int p = 0; p < view->num_planes; p++) {
+		for (int px = 0; px < w; px++) {
+			if (dir > 0) {
+				for (int r = 0; r < view->rows; r++) {
+					uint8_t below = r + 1 < view->rows ? *column(view, p, px, r + 1) : 0;
+					*column(view, p, px, r) = (*column(view, p, px, r) >> 1) | ((below & 1) << 7);
+				}
+			} else {
+				for (int r = view->rows - 1; r >= 0; r--) {
+					uint8_t above = r > 0 ? *column(view, p, px, r - 1) : 0;
+					*column(view, p, px, r) = (*column(view, p, px, r) << 1) | (above >> 7);
+				}
+			}
+		}
+	}
+
+	view->top += dir;
+	int exposed = dir > 0 ? h - 1 : 0;
+	for (int px = 0; px < w; px++) {
+		draw(view, px, exposed);
+	}
+}
+
+
+// Window origin along one axis that keeps pos within the margin,
+// moving as little as possible and staying inside the bounds
+static int follow_axis(int origin, int pos, int size, int bound) {
+	int margin = VIEW_MARGIN < size / 2 ? VIEW_MARGIN : (size - 1) / 2;
+	if (pos - origin < margin) {
+		origin = pos - margin;
+	} else if (pos - origin > size - 1 - margin) {
+		origin = pos - (size - 1 - margin);
+	}
+
+	if (bound > 0) {
+		if (origin > bound - size) {
+			origin = bound - size;
+		}
+		if (origin < 0) {
+			origin = 0;
+		}
+	}
+	return origin;
+}
+
+
+
+/*---------------------------------------------------------------
+  Viewport functions
+ *---------------------------------------------------------------*/
+
+// Remembers the layout; the caller draws
+void view_init(viewport_t* view, framebuffer_t* fb, int cols, int rows,
+	int width, int height, view_source source, void* ctx)
+{
+	view->planes[0] = &fb->wanted;
+	view->num_planes = 1;
+	view->cols = cols;
+	view->rows = rows;
+	view->width = width;
+	view->height = height;
+	view->left = 0;
+	view->top = 0;
+	view->source = source;
+	view->ctx = ctx;
+}
+
+
+// Switches to drawing levels into bit-planes
+void view_planes(viewport_t* view, fb_plane_t* planes, int count) {
+	view->num_planes = count < VIEW_PLANES ? count : VIEW_PLANES;
+	for (int p = 0; p < view->num_planes; p++) {
+		view->planes[p] = &planes[p];
+	}
+}
+
+
+// Looks up the whole window
+void view_redraw(viewport_t* view) {
+	for (int py = 0; py < view->rows * 8; py++) {
+		for (int px = 0; px < view->cols * 8; px++) {
+			draw(view, px, py);
+		}
+	}
+}
+
+
+// Looks up one cell if it is shown
+void view_update(viewport_t* view, int x, int y) {
+	int px = x - view->left;
+	int py = y - view->top;
+	if (0 <= px && px < view->cols * 8 && 0 <= py && py < view->rows * 8) {
+		draw(view, px, py);
+	}
+}
+
+
+// Scrolls towards p a cell at a time, or jumps if it is far away
+void view_follow(viewport_t* view, point_t p) {
+	int w = view->cols * 8;
+	int h = view->rows * 8;
+	int left = follow_axis(view->left, p.x, w, view->width);
+	int top = follow_axis(view->top, p.y, h, view->height);
+
+	if (abs(left - view->left) >= w || abs(top - view->top) >= h) {
+		view->left = left;
+		view->top = top;
+		view_redraw(view);
+		return;
+	}
+
+	while (view->left != left) {
+		scroll_x(view, left > view->left ? 1 : -1);
+	}
+	while (view->top != top) {
+		scroll_y(view, top > view->top ? 1 : -1);
+	}
+}
@@ -0,0 +1,98 @@
+/*
+ * viewport.h
+ *
+ * Window onto a maze, or any other plane of cells, shown on a grid
+ * of chained 8x8 LED matrices through a framebuffer. The window
+ * follows a point, normally the player, and scrolls a pixel at a
+ * time by shifting the framebuffer, so only the row or column that
+ * comes into view has to be looked up.
+ */
+
+#ifndef VIEWPORT_H_
+#define VIEWPORT_H_
+
+#include "mbed.h"
+#include "maze.h"
+#include "framebuffer.h"
+
+
+/*---------------------------------------------------------------
+  Viewport constants
+ *---------------------------------------------------------------*/
+
+// Cells kept between the followed point and the edge of the window
+#define VIEW_MARGIN 2
+
+// Most bit-planes a viewport can draw levels into
+#define VIEW_PLANES 3
+
+
+/*---------------------------------------------------------------
+  Viewport types
+ *---------------------------------------------------------------*/
+
+/**
+ * Returns the brightness level of the cell at (x, y), 0 for off.
+ */
+typedef int (*view_source)(void* ctx, int x, int y);
+
+/**
+ * Type of a viewport. Devices are numbered row by row, so device
+ * 1 + r * cols + c shows the block c across and r down. Width and
+ * height bound the plane the window moves over; 0 leaves that axis
+ * unbounded.
+ *
+ * With one bit-plane, any level but 0 lights a cell. With more, bit
+ * p of the level goes to plane p.
+ */
+typedef struct {
+	fb_plane_t* planes[VIEW_PLANES];
+	int num_planes;
+	int cols;
+	int rows;
+	int width;
+	int height;
+	int left;
+	int top;
+	view_source source;
+	void* ctx;
+} viewport_t;
+
+
+
+/*---------------------------------------------------------------
+  Viewport functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Sets up a viewport over cols x rows devices of a framebuffer,
+ * showing the top left of the plane. Does not draw.
+ */
+void view_init(viewport_t* view, framebuffer_t* fb, int cols, int rows,
+	int width, int height, view_source source, void* ctx);
+
+/**
+ * Draws into consecutive bit-planes instead of the framebuffer, for
+ * levels of brightness. Does not draw.
+ */
+void view_planes(viewport_t* view, fb_plane_t* planes, int count);
+
+/**
+ * Looks up every cell in the window.
+ */
+void view_redraw(viewport_t* view);
+
+/**
+ * Looks up one cell again after it changed. Does nothing if it is
+ * outside the window.
+ */
+void view_update(viewport_t* view, int x, int y);
+
+/**
+ * Scrolls so the point is at least VIEW_MARGIN cells from every
+ * edge of the window, as far as the bounds allow. Moves of less
+ * than a window shift the framebuffer; longer ones redraw.
+ */
+void view_follow(viewport_t* view, point_t p);
+
+#endif /* VIEWPORT_H_ */
@@ -0,0 +1,147 @@
+/*
+ * world.cpp
+ *
+ */
+
+#include "world.h"
+
+/*---------------------------------------------------------------
+  Hashing
+ *---------------------------------------------------------------*/
+
+// Salts separating the hashes of chunk contents and borders
+#define SALT_CHUNK 0x43484E4Bu
+#define SALT_EAST 0x45415354u
+#define SALT_SOUTH 0x534F5554u
+
+// Mixes seed, coordinates and salt into a well spread 32-bit value
+static uint32_t hash(uint32_t seed, int cx, int cy, uint32_t salt) {
+	uint32_t h = seed ^ salt;
+	h = (h ^ (uint32_t) cx) * 0x9E3779B1u;
+	h = (h ^ (h >> 15) ^ (uint32_t) cy) * 0x85EBCA77u;
+	h = (h ^ (h >> 13)) * 0xC2B2AE3Du;
+	return h ^ (h >> 16);
+}
+
+
+// xorshift32 step, never returns 0 for a non-zero state
+static uint32_t next_random(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+
+/*---------------------------------------------------------------
+  Chunk generation
+ *---------------------------------------------------------------*/
+
+// Backtracking over one chunk with an explicit stack, driven by the
+// chunk's own random stream rather than rand()
+static void carve_chunk(chunk_t* chunk, uint32_t seed) {
+	uint32_t state = hash(seed, chunk->cx, chunk->cy, SALT_CHUNK) | 1;
+	point_t stack[CHUNK_SIZE * CHUNK_SIZE];
+	int top = 0;
+
+	memset(chunk->cells, 0, sizeof(chunk->cells));
+	point_t start = {0, 0};
+	stack[top++] = start;
+
+	while (top > 0) {
+		point_t pos = stack[top - 1];
+
+		// Collect unvisited neighbours
+		direction options[4];
+		int count = 0;
+		for (int d = NORTH; d <= WEST; d++) {
+			point_t next = pos;
+			step((direction) d, &next);
+			if (0 <= next.x && next.x < CHUNK_SIZE &&
+				0 <= next.y && next.y < CHUNK_SIZE &&
+				chunk->cells[next.y][next.x] == 0 &&
+				!(next.x == 0 && next.y == 0))
+			{
+				options[count++] = (direction) d;
+			}
+		}
+
+		if (count == 0) {
+			top--;
+			continue;
+		}
+
+		direction d = options[next_random(&state) % count];
+		point_t next = pos;
+		step(d, &next);
+		chunk->cells[pos.y][pos.x] |= mask_of(d);
+		chunk->cells[next.y][next.x] |= mask_of(opposite(d));
+		stack[top++] = next;
+	}
+
+	// Border openings, shared with the neighbouring chunks
+	int cx = chunk->cx;
+	int cy = chunk->cy;
+	int last = CHUNK_SIZE - 1;
+	chunk->cells[hash(seed, cx, cy, SALT_EAST) % CHUNK_SIZE][last] |= mask_of(EAST);
+	chunk->cells[hash(seed, cx - 1, cy, SALT_EAST) % CHUNK_SIZE][0] |= mask_of(WEST);
+	chunk->cells[last][hash(seed, cx, cy, SALT_SOUTH) % CHUNK_SIZE] |= mask_of(SOUTH);
+	chunk->cells[0][hash(seed, cx, cy - 1, SALT_SOUTH) % CHUNK_SIZE] |= mask_of(NORTH);
+}
+
+
+// Finds a chunk in the cache, generating it over the least
+// recently used entry on a miss
+static chunk_t* get_chunk(world_t* world, int cx, int cy) {
+	chunk_t* victim = &world->cache[0];
+	world->clock++;
+
+	for (int i = 0; i < WORLD_CACHE; i++) {
+		chunk_t* chunk = &world->cache[i];
+		if (chunk->valid && chunk->cx == cx && chunk->cy == cy) {
+			chunk->last_used = world->clock;
+			return chunk;
+		}
+		if (!chunk->valid ||
+			(victim->valid && chunk->last_used < victim->last_used))
+		{
+			victim = chunk;
+		}
+	}
+
+	victim->cx = cx;
+	victim->cy = cy;
+	victim->valid = true;
+	victim->last_used = world->clock;
+	carve_chunk(victim, world->seed);
+	world->generated++;
+	return victim;
+}
+
+
+/*---------------------------------------------------------------
+  World functions
+ *---------------------------------------------------------------*/
+
+// Empties the cache
+void init_world(world_t* world, uint32_t seed) {
+	memset(world, 0, sizeof(world_t));
+	world->seed = seed;
+}
+
+
+// Floor division by the chunk size
+int chunk_of(int v) {
+	return v >= 0 ? v / CHUNK_SIZE : -((-v - 1) / CHUNK_SIZE) - 1;
+}
+
+
+// Looks up a global cell through its chunk
+cell world_at(world_t* world, int x, int y) {
+	int cx = chunk_of(x);
+	int cy = chunk_of(y);
+	chunk_t* chunk = get_chunk(world, cx, cy);
+	return chunk->cells[y - cy * CHUNK_SIZE][x - cx * CHUNK_SIZE];
+}
@@ -0,0 +1,77 @@
+/*
+ * world.h
+ *
+ * Endless maze world. The plane is split into CHUNK_SIZE square
+ * chunks, each generated on demand from a hash of the seed and its
+ * chunk coordinates, so any chunk can be rebuilt at any time and
+ * only a few need to be kept in memory.
+ *
+ * Every chunk is a perfect maze with exactly one opening on each of
+ * its four borders. An opening is chosen by hashing the border
+ * itself, so both chunks sharing it agree, and every chunk links to
+ * all four neighbours, which keeps the whole world connected.
+ */
+
+#ifndef WORLD_H_
+#define WORLD_H_
+
+#include "mbed.h"
+#include "maze.h"
+
+
+/*---------------------------------------------------------------
+  World constants
+ *---------------------------------------------------------------*/
+
+#define CHUNK_SIZE 8
+#define WORLD_CACHE 4
+
+
+/*---------------------------------------------------------------
+  World types
+ *---------------------------------------------------------------*/
+
+/**
+ * A generated chunk held in the cache.
+ */
+typedef struct {
+	int cx;
+	int cy;
+	bool valid;
+	uint32_t last_used;
+	cell cells[CHUNK_SIZE][CHUNK_SIZE];
+} chunk_t;
+
+/**
+ * Type of an endless world with a small LRU cache of chunks.
+ */
+typedef struct {
+	uint32_t seed;
+	uint32_t clock;
+	uint32_t generated;
+	chunk_t cache[WORLD_CACHE];
+} world_t;
+
+
+
+/*---------------------------------------------------------------
+  World functions
+ *---------------------------------------------------------------*/
+
+/**
+ * Sets up an empty world for a seed.
+ */
+void init_world(world_t* world, uint32_t seed);
+
+/**
+ * Returns the cell at global position (x, y), generating its chunk
+ * if it is not cached. Any coordinates are valid.
+ */
+cell world_at(world_t* world, int x, int y);
+
+/**
+ * Returns the chunk coordinate holding global coordinate v.
+ */
+int chunk_of(int v);
+
+#endif /* WORLD_H_ */